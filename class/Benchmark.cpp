@@ -0,0 +1,403 @@
+#include "../include/Benchmark.hpp"
+#include "../include/MappedFile.hpp"
+#include "../include/Obj.hpp"
+#include "../include/Vertex.hpp"
+#include "../include/MeshCache.hpp"
+#include "../include/Triangulator.hpp"
+#include "../include/Mipmap.hpp"
+#include "../include/BlockCompression.hpp"
+#include "../include/ThreadPool.hpp"
+#include "../template/WeldTable.tpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+// Runs `function` until at least a second has been spent (and at least 3 times), returns the mean time of a run in seconds
+template <class Function>
+static double measure(Function&& function) {
+    using clock = std::chrono::steady_clock;
+
+    function(); // warm up the page cache and the allocator
+
+    int runs = 0;
+    const auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+
+    while (runs < 3 || elapsed < std::chrono::seconds(1)) {
+        function();
+        ++runs;
+        elapsed = clock::now() - start;
+    }
+
+    return std::chrono::duration<double>(elapsed).count() / runs;
+}
+
+static void report(const std::string& name, const double seconds, const size_t lines, const size_t bytes, const std::string& unit = "lines") {
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed
+              << std::setw(10) << std::setprecision(3) << seconds * 1000.0 << " ms"
+              << std::setw(14) << std::setprecision(0) << static_cast<double>(lines) / seconds << " " << unit << "/s"
+              << std::setw(10) << std::setprecision(1) << static_cast<double>(bytes) / seconds / (1024.0 * 1024.0) << " MiB/s"
+              << std::endl;
+}
+
+void benchmarkLoader(const std::string& path) {
+    size_t lines, bytes;
+    {
+        const MappedFile file(path);
+        bytes = file.getSize();
+        lines = std::ranges::count(file.getView(), '\n');
+    }
+
+    std::cout << "Loader benchmark : " << path << " (" << lines << " lines, " << bytes << " bytes)" << std::endl;
+
+    const Obj reference(path, ObjLoader::Stream);
+    const Obj mapped(path, ObjLoader::Mapped);
+
+    if (reference.getVertices().size() != mapped.getVertices().size() || reference.getFaces().size() != mapped.getFaces().size())
+        std::cerr << "warning: loaders disagree on " << path << std::endl;
+
+    const double stream = measure([&] { const Obj obj(path, ObjLoader::Stream); });
+    report("stream", stream, lines, bytes);
+
+    const double mmap = measure([&] { const Obj obj(path, ObjLoader::Mapped); });
+    report("mapped", mmap, lines, bytes);
+
+    std::cout << "speedup : " << std::setprecision(2) << stream / mmap << "x" << std::endl;
+
+    std::cout << "Parallel scaling (" << std::thread::hardware_concurrency() << " cores) :" << std::endl;
+    for (const unsigned int threads : {1u, 2u, 4u, 8u, 16u}) {
+        const double parallel = measure([&] { const Obj obj(path, ObjLoader::Parallel, threads); });
+        report(std::to_string(threads) + " thr", parallel, lines, bytes);
+    }
+}
+
+void benchmarkWeld(const std::string& path) {
+    const Obj obj(path, ObjLoader::Mapped);
+
+    // the corners as the texture mode builds them, welding is what is measured
+    std::vector<Vertex> corners;
+
+    for (const auto& face : obj.getFaces()) {
+        const size_t count = face.getVerticesIndex().size();
+
+        for (size_t corner = 0; corner < count; corner++) {
+            Vertex vertex{};
+            const auto& position = obj.getVertices()[face.getVerticeIndex(corner) - 1];
+
+            vertex.pos = {position.getX(), position.getY(), position.getZ()};
+            vertex.color = {1.0f, 1.0f, 1.0f};
+
+            if (face.getTextureIndex(corner) != 0) {
+                const auto& uv = obj.getTextureCoordinates()[face.getTextureIndex(corner) - 1];
+                vertex.texCoord = {uv.getX(), 1.0f - uv.getY()};
+            }
+
+            corners.push_back(vertex);
+        }
+    }
+
+    std::cout << "Weld benchmark : " << path << " (" << corners.size() << " corners)" << std::endl;
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+
+    const auto prepare = [&] {
+        vertices.clear();
+        indices.clear();
+        vertices.reserve(corners.size());
+        indices.reserve(corners.size());
+    };
+
+    const double map = measure([&] {
+        prepare();
+        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+        for (const auto& vertex : corners) {
+            if (uniqueVertices.count(vertex) == 0) {
+                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(vertex);
+            }
+
+            indices.push_back(uniqueVertices[vertex]);
+        }
+    });
+    const size_t map_unique = vertices.size();
+
+    const double table = measure([&] {
+        prepare();
+        cookie::WeldTable<std::array<uint32_t, 8>> uniqueVertices(corners.size());
+
+        for (const auto& vertex : corners) {
+            const auto [unique, inserted] = uniqueVertices.insert(vertex.getWeldKey(), static_cast<uint32_t>(vertices.size()));
+
+            if (inserted)
+                vertices.push_back(vertex);
+
+            indices.push_back(unique);
+        }
+    });
+
+    if (map_unique != vertices.size())
+        std::cerr << "warning: weld tables disagree (" << map_unique << " vs " << vertices.size() << " vertices)" << std::endl;
+
+    std::cout << vertices.size() << " unique vertices" << std::endl;
+    report("map", map, corners.size(), corners.size() * sizeof(Vertex), "corners");
+    report("table", table, corners.size(), corners.size() * sizeof(Vertex), "corners");
+    std::cout << "speedup : " << std::setprecision(2) << map / table << "x" << std::endl;
+}
+
+void benchmarkTriangulator() {
+    constexpr size_t POLYGONS = 100000;
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> corners(5, 12);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // regular polygons for the fan path and stars (every other corner pulled in) for ear clipping,
+    // each one turned onto a random plane so the projection is exercised as well
+    std::vector<cookie::Vector3D<float>> points;
+    std::vector<size_t> offsets = {0};
+    std::vector<float> areas;
+    size_t expected = 0;
+
+    for (size_t polygon = 0; polygon < POLYGONS; polygon++) {
+        const size_t count = corners(gen);
+        const bool star = polygon % 2 == 1;
+
+        cookie::Vector3D<float> normal(unit(gen), unit(gen), unit(gen));
+        if (normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f)
+            normal.z = 1.0f;
+        const float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        normal = {normal.x / length, normal.y / length, normal.z / length};
+
+        // tangent and bitangent spanning the plane of `normal`
+        cookie::Vector3D<float> tangent = std::fabs(normal.x) < 0.9f ? cookie::Vector3D<float>(0.0f, -normal.z, normal.y) : cookie::Vector3D<float>(normal.z, 0.0f, -normal.x);
+        const float tangent_length = std::sqrt(tangent.x * tangent.x + tangent.y * tangent.y + tangent.z * tangent.z);
+        tangent = {tangent.x / tangent_length, tangent.y / tangent_length, tangent.z / tangent_length};
+        const cookie::Vector3D<float> bitangent(normal.y * tangent.z - normal.z * tangent.y, normal.z * tangent.x - normal.x * tangent.z, normal.x * tangent.y - normal.y * tangent.x);
+
+        float area = 0.0f;
+        float previous_x = 0.0f, previous_y = 0.0f, first_x = 0.0f, first_y = 0.0f;
+
+        for (size_t corner = 0; corner < count; corner++) {
+            const float angle = 2.0f * std::numbers::pi_v<float> * static_cast<float>(corner) / static_cast<float>(count);
+            const float radius = star && corner % 2 == 1 ? 0.4f : 1.0f;
+            const float x = radius * std::cos(angle);
+            const float y = radius * std::sin(angle);
+
+            points.emplace_back(tangent.x * x + bitangent.x * y, tangent.y * x + bitangent.y * y, tangent.z * x + bitangent.z * y);
+
+            if (corner == 0) {
+                first_x = x;
+                first_y = y;
+            } else {
+                area += previous_x * y - x * previous_y;
+            }
+            previous_x = x;
+            previous_y = y;
+        }
+        area += previous_x * first_y - first_x * previous_y;
+
+        offsets.push_back(points.size());
+        areas.push_back(area / 2.0f);
+        expected += count - 2;
+    }
+
+    std::cout << "Triangulator benchmark : " << POLYGONS << " polygons of 5 to 12 corners (" << expected << " triangles)" << std::endl;
+
+    Triangulator triangulator;
+    std::vector<uint32_t> indices;
+    indices.reserve(expected * 3);
+
+    const auto run = [&] {
+        indices.clear();
+        for (size_t polygon = 0; polygon < POLYGONS; polygon++)
+            triangulator.triangulate(std::span(points).subspan(offsets[polygon], offsets[polygon + 1] - offsets[polygon]), indices);
+    };
+
+    const double seconds = measure(run);
+
+    // every polygon must give n - 2 triangles covering its area
+    run();
+    size_t wrong = 0;
+    size_t cursor = 0;
+
+    for (size_t polygon = 0; polygon < POLYGONS; polygon++) {
+        const auto polygon_points = std::span(points).subspan(offsets[polygon], offsets[polygon + 1] - offsets[polygon]);
+        float area = 0.0f;
+
+        for (size_t triangle = 0; triangle < polygon_points.size() - 2; triangle++, cursor += 3) {
+            const auto& a = polygon_points[indices[cursor]];
+            const auto& b = polygon_points[indices[cursor + 1]];
+            const auto& c = polygon_points[indices[cursor + 2]];
+            const float x = (b.y - a.y) * (c.z - a.z) - (b.z - a.z) * (c.y - a.y);
+            const float y = (b.z - a.z) * (c.x - a.x) - (b.x - a.x) * (c.z - a.z);
+            const float z = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+            area += std::sqrt(x * x + y * y + z * z) / 2.0f;
+        }
+
+        if (std::fabs(area - areas[polygon]) > 1e-3f * areas[polygon])
+            wrong++;
+    }
+
+    if (indices.size() != expected * 3 || wrong != 0)
+        std::cerr << "warning: " << wrong << " polygons badly triangulated" << std::endl;
+
+    report("polygons", seconds, POLYGONS, points.size() * sizeof(cookie::Vector3D<float>), "polygons");
+    report("triangles", seconds, expected, indices.size() * sizeof(uint32_t), "triangles");
+}
+
+void benchmarkPacking(const std::string& path) {
+    const Obj obj(path, ObjLoader::Mapped);
+    const MeshCache mesh(obj, false, false, false);
+    const std::span<const Vertex> vertices = mesh.getVertices();
+
+    std::cout << "Packing benchmark : " << path << " (" << vertices.size() << " vertices)" << std::endl;
+
+    std::vector<PackedVertex> packed;
+    VertexBounds bounds{};
+
+    const double seconds = measure([&] {
+        bounds = packVertices(vertices, packed);
+    });
+
+    // decode like the vertex input does, positions must land within half a step of the 16 bit grid
+    const float extent[3] = {bounds.extent.x, bounds.extent.y, bounds.extent.z};
+    const float origin[3] = {bounds.origin.x, bounds.origin.y, bounds.origin.z};
+    size_t wrong = 0;
+
+    for (size_t index = 0; index < vertices.size(); index++) {
+        const float pos[3] = {vertices[index].pos.x, vertices[index].pos.y, vertices[index].pos.z};
+
+        for (int axis = 0; axis < 3; axis++) {
+            const float decoded = origin[axis] + extent[axis] * (static_cast<float>(packed[index].pos[axis]) / 65535.0f);
+
+            if (std::fabs(decoded - pos[axis]) > extent[axis] / 65535.0f)
+                wrong++;
+        }
+
+        if (std::abs(packed[index].color[0] - vertices[index].color.x * 255.0f) > 0.5f)
+            wrong++;
+    }
+
+    if (wrong != 0)
+        std::cerr << "warning: " << wrong << " components packed out of tolerance" << std::endl;
+
+    std::cout << vertices.size_bytes() << " bytes packed to " << packed.size() * sizeof(PackedVertex)
+              << " (" << std::fixed << std::setprecision(2) << static_cast<double>(sizeof(Vertex)) / sizeof(PackedVertex) << "x smaller)" << std::endl;
+    report("pack", seconds, vertices.size(), vertices.size_bytes(), "vertices");
+}
+
+void benchmarkMipmaps() {
+    // odd sizes on purpose, every level but the last folds a row or a column
+    constexpr uint32_t WIDTH = 2047;
+    constexpr uint32_t HEIGHT = 1023;
+
+    const std::vector<MipLevel> levels = getMipChain(WIDTH, HEIGHT);
+    std::vector<uint8_t> chain(levels.back().offset + levels.back().size);
+
+    std::cout << "Mipmap benchmark : " << WIDTH << "x" << HEIGHT << " (" << levels.size() << " levels)" << std::endl;
+
+    // a checkerboard of two colors, every level keeps averaging to the same linear value
+    for (uint32_t y = 0; y < HEIGHT; y++) {
+        for (uint32_t x = 0; x < WIDTH; x++) {
+            const bool black = (x + y) % 2 == 0;
+            uint8_t* texel = chain.data() + (static_cast<size_t>(y) * WIDTH + x) * 4;
+
+            texel[0] = black ? 0 : 255;
+            texel[1] = black ? 0 : 255;
+            texel[2] = 128;
+            texel[3] = black ? 0 : 255;
+        }
+    }
+
+    const double seconds = measure([&] {
+        buildMipChain(chain.data(), levels);
+    });
+
+    // the 1x1 level is the whole image, linear 0.5 is sRGB 188 and alpha averages to 127.5
+    const uint8_t* last = chain.data() + levels.back().offset;
+    const size_t size = levels.back().offset + levels.back().size;
+
+    if (levels.back().width != 1 || levels.back().height != 1 || std::abs(last[0] - 188) > 1 || last[2] != 128 || std::abs(last[3] - 127) > 1)
+        std::cerr << "warning: last mip level is " << +last[0] << " " << +last[1] << " " << +last[2] << " " << +last[3] << std::endl;
+
+    report("mipmaps", seconds, static_cast<size_t>(WIDTH) * HEIGHT, size, "texels");
+}
+
+void benchmarkBlockCompression() {
+    constexpr uint32_t WIDTH = 1024;
+    constexpr uint32_t HEIGHT = 1024;
+
+    std::vector<uint8_t> image(static_cast<size_t>(WIDTH) * HEIGHT * 4);
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> noise(-6, 6);
+
+    // smooth gradients with a little noise and a hard edge every 64 texels, closer to a painted texture than
+    // pure noise (which no 4x4 block format can keep)
+    for (uint32_t y = 0; y < HEIGHT; y++) {
+        for (uint32_t x = 0; x < WIDTH; x++) {
+            uint8_t* texel = image.data() + (static_cast<size_t>(y) * WIDTH + x) * 4;
+            const int edge = (x / 64 + y / 64) % 2 == 0 ? 0 : 60;
+
+            texel[0] = static_cast<uint8_t>(std::clamp(static_cast<int>(x * 255 / WIDTH) + noise(generator), 0, 255));
+            texel[1] = static_cast<uint8_t>(std::clamp(static_cast<int>(y * 255 / HEIGHT) - edge + 60 + noise(generator), 0, 255));
+            texel[2] = static_cast<uint8_t>(std::clamp(128 + edge + noise(generator), 0, 255));
+            texel[3] = static_cast<uint8_t>(std::clamp(static_cast<int>((x + y) * 255 / (WIDTH + HEIGHT)), 0, 255));
+        }
+    }
+
+    std::cout << "Block compression benchmark : " << WIDTH << "x" << HEIGHT << std::endl;
+
+    ThreadPool pool;
+
+    for (const TextureFormat format : {TextureFormat::BC1, TextureFormat::BC7}) {
+        const bool bc1 = format == TextureFormat::BC1;
+        std::vector<uint8_t> blocks(getCompressedSize(format, WIDTH, HEIGHT));
+
+        const double seconds = measure([&] {
+            compressImage(format, image.data(), WIDTH, HEIGHT, blocks.data(), pool);
+        });
+
+        // BC1 drops alpha, only the color channels count for it
+        const size_t channels = bc1 ? 3 : 4;
+        double error = 0.0;
+        uint8_t texels[4 * 4 * 4];
+
+        for (uint32_t row = 0; row < HEIGHT / 4; row++) {
+            for (uint32_t column = 0; column < WIDTH / 4; column++) {
+                const uint8_t* block = blocks.data() + (static_cast<size_t>(row) * (WIDTH / 4) + column) * getBlockSize(format);
+
+                if (bc1)
+                    decodeBC1Block(block, texels, 16);
+                else
+                    decodeBC7Block(block, texels, 16);
+
+                for (uint32_t i = 0; i < 16; i++) {
+                    const uint8_t* source = image.data() + ((static_cast<size_t>(row) * 4 + i / 4) * WIDTH + column * 4 + i % 4) * 4;
+
+                    for (size_t c = 0; c < channels; c++) {
+                        const double difference = static_cast<double>(texels[i * 4 + c]) - source[c];
+                        error += difference * difference;
+                    }
+                }
+            }
+        }
+
+        const double mse = error / (static_cast<double>(WIDTH) * HEIGHT * channels);
+        const double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+
+        report(bc1 ? "bc1" : "bc7", seconds, static_cast<size_t>(WIDTH) * HEIGHT, image.size(), "texels");
+        std::cout << "  PSNR " << std::setprecision(2) << psnr << " dB" << std::endl;
+
+        if (psnr < (bc1 ? 30.0 : 36.0))
+            std::cerr << "warning: " << (bc1 ? "BC1" : "BC7") << " PSNR is only " << psnr << " dB" << std::endl;
+    }
+}
@@ -0,0 +1,484 @@
+#include "../include/BlockCompression.hpp"
+#include "../include/ThreadPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <vector>
+
+// BC7 interpolation weights of 4 bit indices, out of 64
+static constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// The 16 texels of a block stored channel by channel, so the loops over the texels vectorize
+struct BlockTexels {
+    float channel[4][16];
+};
+
+static BlockTexels loadBlock(const uint8_t* texels, size_t stride) {
+    BlockTexels block{};
+
+    for (size_t y = 0; y < 4; y++)
+        for (size_t x = 0; x < 4; x++)
+            for (size_t c = 0; c < 4; c++)
+                block.channel[c][y * 4 + x] = texels[y * stride + x * 4 + c];
+
+    return block;
+}
+
+// Endpoints spanning the projections of the texels on the principal axis of their first N channels
+template <size_t N>
+static void fitPrincipalAxis(const BlockTexels& block, std::array<float, N>& low, std::array<float, N>& high) {
+    std::array<float, N> mean{};
+
+    for (size_t c = 0; c < N; c++) {
+        for (size_t i = 0; i < 16; i++)
+            mean[c] += block.channel[c][i];
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[N][N] = {};
+    size_t widest = 0;
+
+    for (size_t a = 0; a < N; a++) {
+        for (size_t b = a; b < N; b++) {
+            float sum = 0.0f;
+            for (size_t i = 0; i < 16; i++)
+                sum += (block.channel[a][i] - mean[a]) * (block.channel[b][i] - mean[b]);
+            covariance[a][b] = covariance[b][a] = sum;
+        }
+
+        if (covariance[a][a] > covariance[widest][widest])
+            widest = a;
+    }
+
+    // power iteration from the covariance of the widest channel, which is never orthogonal to the principal
+    // axis unless the block is flat
+    std::array<float, N> axis;
+    for (size_t c = 0; c < N; c++)
+        axis[c] = covariance[widest][c];
+
+    for (int iteration = 0; iteration < 8; iteration++) {
+        std::array<float, N> next{};
+        float length = 0.0f;
+
+        for (size_t a = 0; a < N; a++) {
+            for (size_t b = 0; b < N; b++)
+                next[a] += covariance[a][b] * axis[b];
+            length += next[a] * next[a];
+        }
+
+        if (length <= std::numeric_limits<float>::min())
+            break;
+
+        length = std::sqrt(length);
+        for (size_t c = 0; c < N; c++)
+            axis[c] = next[c] / length;
+    }
+
+    float smallest = std::numeric_limits<float>::max();
+    float largest = std::numeric_limits<float>::lowest();
+
+    for (size_t i = 0; i < 16; i++) {
+        float projection = 0.0f;
+        for (size_t c = 0; c < N; c++)
+            projection += (block.channel[c][i] - mean[c]) * axis[c];
+
+        smallest = std::min(smallest, projection);
+        largest = std::max(largest, projection);
+    }
+
+    // a flat block has a zero axis, both endpoints are its mean
+    if (smallest > largest)
+        smallest = largest = 0.0f;
+
+    for (size_t c = 0; c < N; c++) {
+        low[c] = std::clamp(mean[c] + axis[c] * smallest, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * largest, 0.0f, 255.0f);
+    }
+}
+
+// Endpoints minimizing the squared error of texel i = a_i * first + b_i * second for the given weights,
+// false when the weights do not constrain both (every texel on the same endpoint)
+template <size_t N>
+static bool fitLeastSquares(const BlockTexels& block, const float a[16], const float b[16], std::array<float, N>& first, std::array<float, N>& second) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    std::array<float, N> ax{}, bx{};
+
+    for (size_t i = 0; i < 16; i++) {
+        aa += a[i] * a[i];
+        ab += a[i] * b[i];
+        bb += b[i] * b[i];
+
+        for (size_t c = 0; c < N; c++) {
+            ax[c] += a[i] * block.channel[c][i];
+            bx[c] += b[i] * block.channel[c][i];
+        }
+    }
+
+    const float determinant = aa * bb - ab * ab;
+
+    if (std::fabs(determinant) < 1e-6f)
+        return false;
+
+    for (size_t c = 0; c < N; c++) {
+        first[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+        second[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+    }
+
+    return true;
+}
+
+static uint16_t packRGB565(const std::array<float, 3>& color) {
+    const auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+    const auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+    const auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+
+    return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+static std::array<int, 3> unpackRGB565(uint16_t color) {
+    const int r = color >> 11 & 31;
+    const int g = color >> 5 & 63;
+    const int b = color & 31;
+
+    return {r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2};
+}
+
+// Picks the closest of the four colors for every texel, color0 > color1 (four color mode) or both equal
+static float chooseBC1Indices(const BlockTexels& block, uint16_t color0, uint16_t color1, uint8_t indices[16]) {
+    const std::array<int, 3> c0 = unpackRGB565(color0);
+    const std::array<int, 3> c1 = unpackRGB565(color1);
+
+    float palette[4][3];
+    for (size_t c = 0; c < 3; c++) {
+        palette[0][c] = static_cast<float>(c0[c]);
+        palette[1][c] = static_cast<float>(c1[c]);
+        palette[2][c] = static_cast<float>((2 * c0[c] + c1[c]) / 3);
+        palette[3][c] = static_cast<float>((c0[c] + 2 * c1[c]) / 3);
+    }
+
+    // equal endpoints decode in three color mode, where only index 0 is safe
+    const size_t count = color0 == color1 ? 1 : 4;
+    float total = 0.0f;
+
+    for (size_t i = 0; i < 16; i++) {
+        float best = std::numeric_limits<float>::max();
+
+        for (size_t entry = 0; entry < count; entry++) {
+            float error = 0.0f;
+            for (size_t c = 0; c < 3; c++) {
+                const float difference = block.channel[c][i] - palette[entry][c];
+                error += difference * difference;
+            }
+
+            if (error < best) {
+                best = error;
+                indices[i] = static_cast<uint8_t>(entry);
+            }
+        }
+
+        total += best;
+    }
+
+    return total;
+}
+
+void encodeBC1Block(const uint8_t* texels, size_t stride, uint8_t* block) {
+    const BlockTexels source = loadBlock(texels, stride);
+
+    std::array<float, 3> low, high;
+    fitPrincipalAxis(source, low, high);
+
+    uint16_t color0 = packRGB565(high);
+    uint16_t color1 = packRGB565(low);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint8_t indices[16];
+    float error = chooseBC1Indices(source, color0, color1, indices);
+
+    // weights of color0 and color1 in each of the four palette entries
+    static constexpr float FIRST[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    float a[16], b[16];
+    for (size_t i = 0; i < 16; i++) {
+        a[i] = FIRST[indices[i]];
+        b[i] = 1.0f - a[i];
+    }
+
+    std::array<float, 3> first, second;
+    if (fitLeastSquares(source, a, b, first, second)) {
+        uint16_t refined0 = packRGB565(first);
+        uint16_t refined1 = packRGB565(second);
+        if (refined0 < refined1)
+            std::swap(refined0, refined1);
+
+        uint8_t refinedIndices[16];
+        const float refinedError = chooseBC1Indices(source, refined0, refined1, refinedIndices);
+
+        if (refinedError < error) {
+            color0 = refined0;
+            color1 = refined1;
+            std::memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    uint32_t bits = 0;
+    for (size_t i = 0; i < 16; i++)
+        bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+
+    block[0] = static_cast<uint8_t>(color0);
+    block[1] = static_cast<uint8_t>(color0 >> 8);
+    block[2] = static_cast<uint8_t>(color1);
+    block[3] = static_cast<uint8_t>(color1 >> 8);
+    for (size_t byte = 0; byte < 4; byte++)
+        block[4 + byte] = static_cast<uint8_t>(bits >> (8 * byte));
+}
+
+void decodeBC1Block(const uint8_t* block, uint8_t* texels, size_t stride) {
+    const uint16_t color0 = static_cast<uint16_t>(block[0] | block[1] << 8);
+    const uint16_t color1 = static_cast<uint16_t>(block[2] | block[3] << 8);
+    const uint32_t bits = block[4] | block[5] << 8 | block[6] << 16 | static_cast<uint32_t>(block[7]) << 24;
+
+    const std::array<int, 3> c0 = unpackRGB565(color0);
+    const std::array<int, 3> c1 = unpackRGB565(color1);
+
+    int palette[4][4];
+    for (size_t c = 0; c < 3; c++) {
+        palette[0][c] = c0[c];
+        palette[1][c] = c1[c];
+        palette[2][c] = color0 > color1 ? (2 * c0[c] + c1[c]) / 3 : (c0[c] + c1[c]) / 2;
+        palette[3][c] = color0 > color1 ? (c0[c] + 2 * c1[c]) / 3 : 0;
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = color0 > color1 ? 255 : 0;
+
+    for (size_t i = 0; i < 16; i++) {
+        const int* color = palette[bits >> (2 * i) & 3];
+        uint8_t* texel = texels + (i / 4) * stride + (i % 4) * 4;
+
+        for (size_t c = 0; c < 4; c++)
+            texel[c] = static_cast<uint8_t>(color[c]);
+    }
+}
+
+// 7 bit endpoint and its p-bit closest to `endpoint`, the p-bit is shared by the four channels
+static void quantizeBC7(const std::array<float, 4>& endpoint, std::array<uint8_t, 4>& value, uint8_t& pbit) {
+    float best = std::numeric_limits<float>::max();
+
+    for (uint8_t p = 0; p < 2; p++) {
+        std::array<uint8_t, 4> candidate;
+        float error = 0.0f;
+
+        for (size_t c = 0; c < 4; c++) {
+            candidate[c] = static_cast<uint8_t>(std::clamp<long>(std::lround((endpoint[c] - p) / 2.0f), 0, 127));
+
+            const float difference = static_cast<float>(candidate[c] * 2 + p) - endpoint[c];
+            error += difference * difference;
+        }
+
+        if (error < best) {
+            best = error;
+            value = candidate;
+            pbit = p;
+        }
+    }
+}
+
+static float chooseBC7Indices(const BlockTexels& block, const std::array<uint8_t, 4>& value0, uint8_t pbit0, const std::array<uint8_t, 4>& value1, uint8_t pbit1, uint8_t indices[16]) {
+    float palette[16][4];
+
+    for (size_t entry = 0; entry < 16; entry++) {
+        for (size_t c = 0; c < 4; c++) {
+            const int e0 = value0[c] * 2 + pbit0;
+            const int e1 = value1[c] * 2 + pbit1;
+            palette[entry][c] = static_cast<float>(((64 - BC7_WEIGHTS[entry]) * e0 + BC7_WEIGHTS[entry] * e1 + 32) >> 6);
+        }
+    }
+
+    float total = 0.0f;
+
+    for (size_t i = 0; i < 16; i++) {
+        float best = std::numeric_limits<float>::max();
+
+        for (size_t entry = 0; entry < 16; entry++) {
+            float error = 0.0f;
+            for (size_t c = 0; c < 4; c++) {
+                const float difference = block.channel[c][i] - palette[entry][c];
+                error += difference * difference;
+            }
+
+            if (error < best) {
+                best = error;
+                indices[i] = static_cast<uint8_t>(entry);
+            }
+        }
+
+        total += best;
+    }
+
+    return total;
+}
+
+// Bits of a block written and read from its least significant bit on, like BC7 lays them out
+class BlockBits {
+    private:
+        uint8_t* data;
+        size_t position = 0;
+
+    public:
+        explicit BlockBits(uint8_t* data) : data(data) {}
+
+        void write(uint32_t value, size_t count) {
+            for (size_t bit = 0; bit < count; bit++, this->position++)
+                if (value >> bit & 1)
+                    this->data[this->position / 8] |= static_cast<uint8_t>(1 << this->position % 8);
+        }
+
+        uint32_t read(size_t count) {
+            uint32_t value = 0;
+
+            for (size_t bit = 0; bit < count; bit++, this->position++)
+                value |= static_cast<uint32_t>(this->data[this->position / 8] >> this->position % 8 & 1) << bit;
+
+            return value;
+        }
+};
+
+void encodeBC7Block(const uint8_t* texels, size_t stride, uint8_t* block) {
+    const BlockTexels source = loadBlock(texels, stride);
+
+    std::array<float, 4> low, high;
+    fitPrincipalAxis(source, low, high);
+
+    std::array<uint8_t, 4> value0, value1;
+    uint8_t pbit0, pbit1;
+    quantizeBC7(low, value0, pbit0);
+    quantizeBC7(high, value1, pbit1);
+
+    uint8_t indices[16];
+    float error = chooseBC7Indices(source, value0, pbit0, value1, pbit1, indices);
+
+    float a[16], b[16];
+    for (size_t i = 0; i < 16; i++) {
+        b[i] = static_cast<float>(BC7_WEIGHTS[indices[i]]) / 64.0f;
+        a[i] = 1.0f - b[i];
+    }
+
+    std::array<float, 4> first, second;
+    if (fitLeastSquares(source, a, b, first, second)) {
+        std::array<uint8_t, 4> refined0, refined1;
+        uint8_t refinedPbit0, refinedPbit1;
+        quantizeBC7(first, refined0, refinedPbit0);
+        quantizeBC7(second, refined1, refinedPbit1);
+
+        uint8_t refinedIndices[16];
+        const float refinedError = chooseBC7Indices(source, refined0, refinedPbit0, refined1, refinedPbit1, refinedIndices);
+
+        if (refinedError < error) {
+            value0 = refined0;
+            value1 = refined1;
+            pbit0 = refinedPbit0;
+            pbit1 = refinedPbit1;
+            std::memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    // the first index is stored without its top bit, swapping the endpoints clears it
+    if (indices[0] >= 8) {
+        std::swap(value0, value1);
+        std::swap(pbit0, pbit1);
+        for (uint8_t& index : indices)
+            index = static_cast<uint8_t>(15 - index);
+    }
+
+    std::memset(block, 0, 16);
+    BlockBits bits(block);
+
+    bits.write(1 << 6, 7);
+    for (size_t c = 0; c < 4; c++) {
+        bits.write(value0[c], 7);
+        bits.write(value1[c], 7);
+    }
+    bits.write(pbit0, 1);
+    bits.write(pbit1, 1);
+
+    bits.write(indices[0], 3);
+    for (size_t i = 1; i < 16; i++)
+        bits.write(indices[i], 4);
+}
+
+void decodeBC7Block(const uint8_t* block, uint8_t* texels, size_t stride) {
+    uint8_t copy[16];
+    std::memcpy(copy, block, sizeof(copy));
+    BlockBits bits(copy);
+
+    if (bits.read(7) != 1 << 6) {
+        for (size_t y = 0; y < 4; y++)
+            std::memset(texels + y * stride, 0, 16);
+        return;
+    }
+
+    uint32_t values[2][4];
+    for (size_t c = 0; c < 4; c++) {
+        values[0][c] = bits.read(7);
+        values[1][c] = bits.read(7);
+    }
+
+    const uint32_t pbit0 = bits.read(1);
+    const uint32_t pbit1 = bits.read(1);
+
+    for (size_t i = 0; i < 16; i++) {
+        const uint32_t index = bits.read(i == 0 ? 3 : 4);
+        const int weight = BC7_WEIGHTS[index];
+        uint8_t* texel = texels + (i / 4) * stride + (i % 4) * 4;
+
+        for (size_t c = 0; c < 4; c++) {
+            const int e0 = static_cast<int>(values[0][c] << 1 | pbit0);
+            const int e1 = static_cast<int>(values[1][c] << 1 | pbit1);
+            texel[c] = static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+        }
+    }
+}
+
+size_t getBlockSize(TextureFormat format) {
+    return format == TextureFormat::BC1 ? 8 : 16;
+}
+
+size_t getCompressedSize(TextureFormat format, uint32_t width, uint32_t height) {
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+void compressImage(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* blocks, ThreadPool& pool) {
+    const uint32_t columns = (width + 3) / 4;
+    const uint32_t rows = (height + 3) / 4;
+    const size_t blockSize = getBlockSize(format);
+    const auto encode = format == TextureFormat::BC1 ? encodeBC1Block : encodeBC7Block;
+
+    std::vector<std::future<void>> tasks;
+    tasks.reserve(rows);
+
+    for (uint32_t row = 0; row < rows; row++) {
+        tasks.push_back(pool.submit([=] {
+            uint8_t texels[4 * 4 * 4];
+
+            for (uint32_t column = 0; column < columns; column++) {
+                for (uint32_t y = 0; y < 4; y++) {
+                    const uint32_t sourceY = std::min(row * 4 + y, height - 1);
+
+                    for (uint32_t x = 0; x < 4; x++) {
+                        const uint32_t sourceX = std::min(column * 4 + x, width - 1);
+                        std::memcpy(texels + (y * 4 + x) * 4, pixels + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+                    }
+                }
+
+                encode(texels, 16, blocks + (static_cast<size_t>(row) * columns + column) * blockSize);
+            }
+        }));
+    }
+
+    for (auto& task : tasks)
+        task.get();
+}
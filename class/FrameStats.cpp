@@ -0,0 +1,57 @@
+#include "../include/FrameStats.hpp"
+
+#include <iomanip>
+
+FrameStats::FrameStats(clock::duration period) : periodStart(clock::now()), period(period) {}
+
+void FrameStats::add(Timing timing, double milliseconds) {
+    this->totals[timing] += milliseconds;
+    this->counts[timing]++;
+}
+
+bool FrameStats::endFrame() {
+    this->frames++;
+
+    return clock::now() - this->periodStart >= this->period;
+}
+
+void FrameStats::reset() {
+    this->totals.fill(0.0);
+    this->counts.fill(0);
+    this->frames = 0;
+    this->periodStart = clock::now();
+}
+
+double FrameStats::getAverage(Timing timing) const {
+    return this->counts[timing] > 0 ? this->totals[timing] / static_cast<double>(this->counts[timing]) : 0.0;
+}
+
+size_t FrameStats::getCount(Timing timing) const {
+    return counts[timing];
+}
+
+size_t FrameStats::getFrames() const {
+    return frames;
+}
+
+std::ostream& operator<<(std::ostream& os, const FrameStats& stats) {
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+
+    os << std::fixed << std::setprecision(3);
+    os << "Frame stats over " << stats.getFrames() << " frames: cpu " << stats.getAverage(FrameStats::CPU_FRAME) << " ms"
+       << " (fence wait " << stats.getAverage(FrameStats::FENCE_WAIT) << " ms, acquire " << stats.getAverage(FrameStats::ACQUIRE) << " ms)";
+
+    // without timestamp support, or before the first results are read back
+    if (stats.getCount(FrameStats::GPU_RENDER_PASS) > 0)
+        os << ", gpu render pass " << stats.getAverage(FrameStats::GPU_RENDER_PASS) << " ms";
+
+    // uploads are only timed on the frames acquiring them
+    if (stats.getCount(FrameStats::GPU_UPLOADS) > 0)
+        os << ", gpu uploads " << stats.getAverage(FrameStats::GPU_UPLOADS) << " ms over " << stats.getCount(FrameStats::GPU_UPLOADS) << " frames";
+
+    os.flags(flags);
+    os.precision(precision);
+
+    return os;
+}
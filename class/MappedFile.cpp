@@ -0,0 +1,78 @@
+#include "../include/MappedFile.hpp"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd == -1) {
+        throw std::invalid_argument("File could not be opened");
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        throw std::runtime_error("File could not be stat'd");
+    }
+
+    this->size = static_cast<size_t>(info.st_size);
+
+    // mmap refuses zero length mappings, an empty file is simply an empty view
+    if (this->size != 0) {
+        void* mapping = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("File could not be mapped");
+        }
+
+        madvise(mapping, this->size, MADV_SEQUENTIAL);
+        this->data = static_cast<const char*>(mapping);
+    }
+
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (this->data != nullptr)
+        munmap(const_cast<char*>(this->data), this->size);
+}
+
+const char* MappedFile::getData() const {
+    return data;
+}
+
+size_t MappedFile::getSize() const {
+    return size;
+}
+
+std::string_view MappedFile::getView() const {
+    return {data, size};
+}
+
+FileStamp stampFile(const std::string& path) {
+    struct stat info{};
+
+    if (stat(path.c_str(), &info) == -1) {
+        throw std::invalid_argument("File could not be opened");
+    }
+
+    return {static_cast<uint64_t>(info.st_size), static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec};
+}
+
+uint64_t hashFile(const std::string& path) {
+    const MappedFile file(path);
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (const char character : file.getView()) {
+        hash ^= static_cast<unsigned char>(character);
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
@@ -0,0 +1,231 @@
+#include "../include/MemoryAllocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <stdexcept>
+
+MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device) : device(device) {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &this->memoryProperties);
+
+    this->pools.resize(this->memoryProperties.memoryTypeCount * 2);
+}
+
+MemoryAllocator::~MemoryAllocator() {
+    for (auto& pool: this->pools)
+        for (auto& block: pool)
+            this->destroyBlock(block);
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < this->memoryProperties.memoryTypeCount; i++) {
+        if (typeFilter & 1 << i && (this->memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+VkDeviceSize MemoryAllocator::getBlockSize(uint32_t memoryType, VkDeviceSize size) const {
+    const VkDeviceSize heap = this->memoryProperties.memoryHeaps[this->memoryProperties.memoryTypes[memoryType].heapIndex].size;
+
+    // small heaps (the 256 MiB host visible device local window) get smaller blocks so a few of them still fit
+    VkDeviceSize blockSize = BLOCK_SIZE;
+    if (heap / 8 < blockSize)
+        blockSize = std::bit_floor(std::max(heap / 8, MIN_SIZE));
+
+    return std::max(blockSize, size);
+}
+
+uint32_t MemoryAllocator::createBlock(uint32_t pool, VkDeviceSize size) {
+    const uint32_t memoryType = pool / 2;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    Block block;
+    block.size = size;
+
+    if (vkAllocateMemory(this->device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory block!");
+    }
+
+    if (this->memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(this->device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped) != VK_SUCCESS) {
+            vkFreeMemory(this->device, block.memory, nullptr);
+            throw std::runtime_error("failed to map device memory block!");
+        }
+    }
+
+    // the whole block starts as a single free range of the highest order
+    block.free.resize(std::countr_zero(size / MIN_SIZE) + 1);
+    block.free.back().insert(0);
+
+    auto& blocks = this->pools[pool];
+    const auto slot = std::ranges::find_if(blocks, [](const Block& block) { return block.memory == VK_NULL_HANDLE; });
+
+    if (slot != blocks.end()) {
+        *slot = std::move(block);
+        return static_cast<uint32_t>(slot - blocks.begin());
+    }
+
+    blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(blocks.size() - 1);
+}
+
+void MemoryAllocator::destroyBlock(Block& block) {
+    if (block.memory == VK_NULL_HANDLE)
+        return;
+
+    if (block.mapped != nullptr)
+        vkUnmapMemory(this->device, block.memory);
+    vkFreeMemory(this->device, block.memory, nullptr);
+
+    block = Block{};
+}
+
+bool MemoryAllocator::split(Block& block, uint32_t order, VkDeviceSize& offset) {
+    uint32_t current = order;
+
+    while (current < block.free.size() && block.free[current].empty())
+        current++;
+
+    if (current >= block.free.size())
+        return false;
+
+    offset = *block.free[current].begin();
+    block.free[current].erase(block.free[current].begin());
+
+    // keep the lower half, the upper half of every split becomes a free buddy
+    while (current > order) {
+        current--;
+        block.free[current].insert(offset + (MIN_SIZE << current));
+    }
+
+    return true;
+}
+
+Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear) {
+    const uint32_t memoryType = this->findMemoryType(requirements.memoryTypeBits, properties);
+    const uint32_t pool = memoryType * 2 + (linear ? 0 : 1);
+
+    // buddy ranges are aligned on their own size, and a fresh block on anything a resource can require
+    const VkDeviceSize size = std::bit_ceil(std::max({requirements.size, requirements.alignment, MIN_SIZE}));
+    const uint32_t order = std::countr_zero(size / MIN_SIZE);
+
+    uint32_t index = 0;
+    VkDeviceSize offset = 0;
+    bool found = false;
+
+    for (; index < this->pools[pool].size() && found == false; index++) {
+        Block& block = this->pools[pool][index];
+
+        if (block.memory != VK_NULL_HANDLE && order < block.free.size())
+            found = split(block, order, offset);
+    }
+
+    if (found) {
+        index--;
+    } else {
+        index = this->createBlock(pool, this->getBlockSize(memoryType, size));
+        split(this->pools[pool][index], order, offset);
+    }
+
+    Block& block = this->pools[pool][index];
+    block.used += size;
+    block.requested += requirements.size;
+    block.allocations++;
+    this->allocationCount++;
+
+    Allocation allocation;
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.size = requirements.size;
+    allocation.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + offset : nullptr;
+    allocation.pool = pool;
+    allocation.block = index;
+    allocation.order = order;
+
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation) {
+    if (allocation.memory == VK_NULL_HANDLE)
+        return;
+
+    auto& blocks = this->pools[allocation.pool];
+    Block& block = blocks[allocation.block];
+    VkDeviceSize offset = allocation.offset;
+    uint32_t order = allocation.order;
+
+    block.used -= MIN_SIZE << order;
+    block.requested -= allocation.size;
+    block.allocations--;
+    this->allocationCount--;
+
+    // merge with the buddy as long as it is free as well
+    while (order + 1 < block.free.size() && block.free[order].erase(offset ^ (MIN_SIZE << order)) != 0) {
+        offset &= ~(MIN_SIZE << order);
+        order++;
+    }
+    block.free[order].insert(offset);
+
+    // an empty block is given back to the driver, unless it is the last one of its pool (transient staging
+    // buffers would otherwise allocate and free a block every upload)
+    if (block.allocations == 0) {
+        const auto live = std::ranges::count_if(blocks, [](const Block& block) { return block.memory != VK_NULL_HANDLE; });
+
+        if (live > 1)
+            this->destroyBlock(block);
+    }
+
+    allocation = Allocation{};
+}
+
+std::ostream& operator<<(std::ostream& os, const MemoryAllocator& allocator) {
+    constexpr double MIB = 1024.0 * 1024.0;
+
+    size_t blocks = 0;
+    VkDeviceSize reserved = 0;
+    VkDeviceSize used = 0;
+
+    os << "Device memory: " << allocator.allocationCount << " allocations" << std::fixed << std::setprecision(2);
+
+    for (uint32_t pool = 0; pool < allocator.pools.size(); pool++) {
+        for (const auto& block: allocator.pools[pool]) {
+            if (block.memory == VK_NULL_HANDLE)
+                continue;
+
+            VkDeviceSize free = 0;
+            VkDeviceSize largest = 0;
+            size_t ranges = 0;
+
+            for (uint32_t order = 0; order < block.free.size(); order++) {
+                free += block.free[order].size() * (MemoryAllocator::MIN_SIZE << order);
+                ranges += block.free[order].size();
+                if (block.free[order].empty() == false)
+                    largest = MemoryAllocator::MIN_SIZE << order;
+            }
+
+            // external fragmentation: the share of the free memory that the largest free range cannot serve
+            const double fragmentation = free != 0 ? 100.0 * (1.0 - static_cast<double>(largest) / static_cast<double>(free)) : 0.0;
+
+            os << std::endl << "  type " << pool / 2 << (pool % 2 == 0 ? " linear " : " optimal")
+               << " block " << std::setw(8) << block.size / MIB << " MiB, "
+               << block.allocations << " allocations, "
+               << block.requested / MIB << " MiB requested in " << block.used / MIB << " MiB, "
+               << ranges << " free ranges, fragmentation " << fragmentation << "%";
+
+            blocks++;
+            reserved += block.size;
+            used += block.used;
+        }
+    }
+
+    os << std::endl << "Device memory: " << blocks << " blocks, " << used / MIB << " MiB in use of " << reserved / MIB << " MiB";
+
+    return os;
+}
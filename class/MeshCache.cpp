@@ -0,0 +1,455 @@
+#include "../include/MeshCache.hpp"
+#include "../include/Triangulator.hpp"
+#include "../include/MeshOptimizer.hpp"
+#include "../template/WeldTable.tpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+static constexpr char MAGIC[8] = {'S', 'C', 'O', 'P', 'E', 'M', 'S', 'H'};
+static constexpr uint32_t VERSION = 3;
+static constexpr uint32_t FLAG_TEXTURED = 1;
+static constexpr uint32_t FLAG_OPTIMIZED = 2;
+static constexpr uint64_t ALIGNMENT = 16;
+
+// On-disk layout: this header, the '\0' terminated material paths, then the vertices, indices and sub-meshes,
+// every block starting on a 16 byte boundary so the spans can point into the mapping
+struct MeshCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t vertex_size;
+    uint32_t material_count;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    uint64_t material_offset;
+    uint64_t material_bytes;
+    uint64_t vertex_offset;
+    uint64_t vertex_count;
+    uint64_t index_offset;
+    uint64_t index_count;
+    uint64_t submesh_offset;
+    uint64_t submesh_count;
+};
+
+static uint64_t align(uint64_t offset) {
+    return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+MeshCache::MeshCache(const std::string& path) {
+    const FileStamp stamp = stampFile(path);
+
+    this->file.emplace(getCachePath(path));
+
+    const char* data = this->file->getData();
+    const uint64_t size = this->file->getSize();
+
+    MeshCacheHeader header{};
+
+    if (size < sizeof(header)) {
+        throw std::runtime_error("mesh cache is truncated");
+    }
+
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || header.vertex_size != sizeof(Vertex)) {
+        throw std::runtime_error("mesh cache has an unknown format");
+    }
+
+    if (header.source_size != stamp.size) {
+        throw std::runtime_error("mesh cache is out of date");
+    }
+
+    // a touched or copied model keeps its cache as long as the content did not change
+    if (header.source_mtime != stamp.mtime && header.source_hash != hashFile(path)) {
+        throw std::runtime_error("mesh cache is out of date");
+    }
+
+    const auto inside = [size](uint64_t offset, uint64_t bytes) {
+        return offset % ALIGNMENT == 0 && offset <= size && bytes <= size - offset;
+    };
+
+    if (!inside(header.material_offset, header.material_bytes)) {
+        throw std::runtime_error("mesh cache is truncated");
+    }
+
+    const char* material = data + header.material_offset;
+    const char* material_end = material + header.material_bytes;
+
+    for (uint32_t index = 0; index < header.material_count; index++) {
+        const char* end = static_cast<const char*>(std::memchr(material, '\0', material_end - material));
+
+        if (end == nullptr) {
+            throw std::runtime_error("mesh cache is truncated");
+        }
+
+        this->material_path.emplace_back(material, end);
+        material = end + 1;
+    }
+
+    if (header.vertex_count > size / sizeof(Vertex) || header.index_count > size / sizeof(uint16_t) || header.submesh_count > size / sizeof(SubMesh)
+        || !inside(header.vertex_offset, header.vertex_count * sizeof(Vertex))
+        || !inside(header.index_offset, header.index_count * sizeof(uint16_t))
+        || !inside(header.submesh_offset, header.submesh_count * sizeof(SubMesh))) {
+        throw std::runtime_error("mesh cache is truncated");
+    }
+
+    this->vertices = {reinterpret_cast<const Vertex*>(data + header.vertex_offset), header.vertex_count};
+    this->indices = {reinterpret_cast<const uint16_t*>(data + header.index_offset), header.index_count};
+    this->submeshes = {reinterpret_cast<const SubMesh*>(data + header.submesh_offset), header.submesh_count};
+
+    for (const SubMesh& submesh : this->submeshes) {
+        if (submesh.firstIndex > header.index_count || submesh.indexCount > header.index_count - submesh.firstIndex
+            || submesh.vertexOffset < 0 || static_cast<uint64_t>(submesh.vertexOffset) > header.vertex_count) {
+            throw std::runtime_error("mesh cache is corrupted");
+        }
+
+        // every index of the submesh has to land in the vertex buffer once shifted by its vertex offset
+        const uint64_t reachable = header.vertex_count - static_cast<uint64_t>(submesh.vertexOffset);
+
+        for (const uint16_t index : this->indices.subspan(submesh.firstIndex, submesh.indexCount)) {
+            if (index >= reachable) {
+                throw std::runtime_error("mesh cache is corrupted");
+            }
+        }
+    }
+
+    this->textured = header.flags & FLAG_TEXTURED;
+    this->optimized = header.flags & FLAG_OPTIMIZED;
+}
+
+MeshCache::MeshCache(const Obj& obj, bool textured, bool optimize, bool verbose) : material_path(obj.getMaterialPath()), textured(textured), optimized(optimize) {
+    std::vector<uint32_t> indices;
+
+    buildMesh(obj, textured, verbose, this->vertices_storage, indices);
+
+    // the optimizer and the split move whole triangles and keep the order of their corners, so the
+    // provoking vertices stay first
+    if (optimize) {
+        const float before = verbose ? computeACMR(indices) : 0.0f;
+
+        optimizeMesh(this->vertices_storage, indices);
+
+        if (verbose)
+            std::cout << "ACMR: " << before << " -> " << computeACMR(indices) << std::endl;
+    }
+
+    splitMesh(this->vertices_storage, indices, this->indices_storage, this->submeshes_storage);
+
+    this->vertices = this->vertices_storage;
+    this->indices = this->indices_storage;
+    this->submeshes = this->submeshes_storage;
+}
+
+MeshCache::~MeshCache() = default;
+
+void MeshCache::buildMesh(const Obj& obj, bool textured, bool verbose, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    vertices.clear();
+    indices.clear();
+
+    const size_t corners = obj.getFaceVerticesIndex().size();
+
+    // Corners are welded on the (v, vt) indices they read, the Vertex of a pair is only built and welded
+    // on its values the first time the pair is seen (exporters often duplicate v and vt lines). Only the
+    // model uv are shared between faces, random uv are given per face so the corners of a face are its
+    // vertices.
+    const bool shared = textured;
+    cookie::WeldTable<std::array<int, 2>> uniqueCorners(shared ? corners : 0);
+    cookie::WeldTable<std::array<uint32_t, 8>> uniqueVertices(shared ? corners : 0);
+    std::vector<uint32_t> cornerVertex;
+
+    Triangulator triangulator;
+    std::vector<uint32_t> corner_index;
+
+    // The face color only has to be on the provoking vertex of each triangle. A triangle is rotated to start
+    // on a vertex its face already owns, or else on one no face owns yet, and only when all three belong to
+    // other faces is its first vertex duplicated. Rotating keeps the winding.
+    constexpr uint32_t UNOWNED = UINT32_MAX;
+    std::vector<uint32_t> owner;
+    uint32_t face = 0;
+    size_t duplicated = 0;
+
+    // a polygon of n corners gives n - 2 triangles
+    vertices.reserve(corners);
+    indices.reserve(3 * (corners - std::min(corners, 2 * obj.getFaces().size())));
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_real_distribution<float> dis(0.0f, 0.9f);
+
+    for (const auto& shape: obj.getFaces()) {
+        face++;
+
+        const float white = dis(gen);
+
+        const float x = dis(gen);
+        const float y = dis(gen);
+
+        if (verbose) {
+            std::cout << "Face color : " << white << std::endl;
+            std::cout << "Face coord : " << x << " " << y << " " << std::endl;
+        }
+
+        const size_t count = shape.getVerticesIndex().size();
+
+        // points and lines have nothing to draw
+        if (count < 3)
+            continue;
+
+        corner_index.resize(count);
+
+        for (size_t corner = 0; corner < count; corner++) {
+            if (shared) {
+                const auto [pair, inserted] = uniqueCorners.insert({shape.getVerticeIndex(corner), shape.getTextureIndex(corner)}, static_cast<uint32_t>(cornerVertex.size()));
+
+                if (inserted == false) {
+                    corner_index[corner] = cornerVertex[pair];
+                    continue;
+                }
+            }
+
+            Vertex vertex{};
+
+            const auto& position = obj.getVertices()[shape.getVerticeIndex(corner) - 1];
+            vertex.pos = {position.getX(), position.getY(), position.getZ()};
+
+            if (shared) {
+                const auto& uv = obj.getTextureCoordinates()[shape.getTextureIndex(corner) - 1];
+                vertex.texCoord = {uv.getX(), 1.0f - uv.getY()};
+            } else {
+                vertex.texCoord.x = x;
+                vertex.texCoord.y = y;
+            }
+
+            corner_index[corner] = static_cast<uint32_t>(vertices.size());
+
+            if (shared) {
+                const auto [unique, inserted] = uniqueVertices.insert(vertex.getWeldKey(), corner_index[corner]);
+
+                corner_index[corner] = unique;
+                cornerVertex.push_back(unique);
+                if (inserted == false)
+                    continue;
+            }
+
+            vertices.push_back(vertex);
+        }
+
+        const size_t first = indices.size();
+
+        triangulator.triangulate(shape.getVerticesIndex(), obj.getVertices(), corner_index, indices);
+
+        owner.resize(vertices.size(), UNOWNED);
+
+        for (size_t triangle = first; triangle < indices.size(); triangle += 3) {
+            const auto corners_begin = indices.begin() + static_cast<std::ptrdiff_t>(triangle);
+            auto provoking = std::find_if(corners_begin, corners_begin + 3, [&](uint32_t index) { return owner[index] == face; });
+
+            if (provoking == corners_begin + 3)
+                provoking = std::find_if(corners_begin, corners_begin + 3, [&](uint32_t index) { return owner[index] == UNOWNED; });
+
+            if (provoking == corners_begin + 3) {
+                provoking = corners_begin;
+                const Vertex copy = vertices[*provoking];
+                vertices.push_back(copy);
+                owner.push_back(UNOWNED);
+                *provoking = static_cast<uint32_t>(vertices.size() - 1);
+                duplicated++;
+            }
+
+            owner[*provoking] = face;
+            vertices[*provoking].color = {white, white, white};
+
+            std::rotate(corners_begin, provoking, corners_begin + 3);
+        }
+    }
+
+    if (verbose)
+        std::cout << "Provoking vertices duplicated: " << duplicated << std::endl;
+}
+
+void MeshCache::splitMesh(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<uint16_t>& local, std::vector<SubMesh>& submeshes) {
+    constexpr size_t LIMIT = 65536;
+
+    local.clear();
+    submeshes.clear();
+
+    if (indices.empty())
+        return;
+
+    local.reserve(indices.size());
+
+    if (vertices.size() <= LIMIT) {
+        for (const uint32_t index : indices)
+            local.push_back(static_cast<uint16_t>(index));
+
+        submeshes.push_back({0, static_cast<uint32_t>(indices.size()), 0});
+        return;
+    }
+
+    // Triangles are taken in order, a new sub-mesh starts when the next one would reference more than
+    // LIMIT vertices. Each sub-mesh gets a copy of the vertices it uses, so only the vertices shared
+    // across a split are duplicated and the vertex cache order of the triangles is kept.
+    constexpr uint32_t UNUSED = UINT32_MAX;
+
+    std::vector<Vertex> split;
+    std::vector<uint32_t> owner(vertices.size(), UNUSED);
+    std::vector<uint16_t> remap(vertices.size());
+    uint32_t current = 0;
+    size_t used = 0;
+
+    split.reserve(vertices.size());
+    submeshes.push_back({0, 0, 0});
+
+    for (size_t corner = 0; corner < indices.size(); corner += 3) {
+        size_t missing = 0;
+        for (size_t offset = 0; offset < 3; offset++)
+            missing += owner[indices[corner + offset]] != current;
+
+        if (used + missing > LIMIT) {
+            current++;
+            used = 0;
+            submeshes.push_back({static_cast<uint32_t>(corner), 0, static_cast<int32_t>(split.size())});
+        }
+
+        for (size_t offset = 0; offset < 3; offset++) {
+            const uint32_t index = indices[corner + offset];
+
+            if (owner[index] != current) {
+                owner[index] = current;
+                remap[index] = static_cast<uint16_t>(used++);
+                split.push_back(vertices[index]);
+            }
+
+            local.push_back(remap[index]);
+        }
+
+        submeshes.back().indexCount += 3;
+    }
+
+    vertices = std::move(split);
+}
+
+void MeshCache::save(const std::string& path) const {
+    const FileStamp stamp = stampFile(path);
+
+    MeshCacheHeader header{};
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.flags = (this->textured ? FLAG_TEXTURED : 0) | (this->optimized ? FLAG_OPTIMIZED : 0);
+    header.vertex_size = sizeof(Vertex);
+    header.material_count = static_cast<uint32_t>(this->material_path.size());
+    header.source_size = stamp.size;
+    header.source_mtime = stamp.mtime;
+    header.source_hash = hashFile(path);
+
+    uint64_t offset = align(sizeof(header));
+
+    header.material_offset = offset;
+    for (const auto& material : this->material_path)
+        header.material_bytes += material.size() + 1;
+    offset = align(offset + header.material_bytes);
+
+    header.vertex_offset = offset;
+    header.vertex_count = this->vertices.size();
+    offset = align(offset + this->vertices.size_bytes());
+
+    header.index_offset = offset;
+    header.index_count = this->indices.size();
+    offset = align(offset + this->indices.size_bytes());
+
+    header.submesh_offset = offset;
+    header.submesh_count = this->submeshes.size();
+
+    const std::string cache = getCachePath(path);
+    const std::string temporary = cache + ".tmp";
+
+    std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+
+    if (!output) {
+        throw std::runtime_error("failed to create mesh cache!");
+    }
+
+    uint64_t written = 0;
+
+    const auto write = [&](uint64_t at, const void* bytes, uint64_t count) {
+        static constexpr char padding[ALIGNMENT] = {};
+
+        output.write(padding, static_cast<std::streamsize>(at - written));
+        output.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(count));
+        written = at + count;
+    };
+
+    write(0, &header, sizeof(header));
+
+    uint64_t material_offset = header.material_offset;
+    for (const auto& material : this->material_path) {
+        write(material_offset, material.c_str(), material.size() + 1);
+        material_offset += material.size() + 1;
+    }
+
+    write(header.vertex_offset, this->vertices.data(), this->vertices.size_bytes());
+    write(header.index_offset, this->indices.data(), this->indices.size_bytes());
+    write(header.submesh_offset, this->submeshes.data(), this->submeshes.size_bytes());
+
+    output.close();
+
+    if (!output) {
+        std::filesystem::remove(temporary);
+        throw std::runtime_error("failed to write mesh cache!");
+    }
+
+    std::filesystem::rename(temporary, cache);
+}
+
+std::string MeshCache::getCachePath(const std::string& path) {
+    return path + ".scopecache";
+}
+
+std::span<const Vertex> MeshCache::getVertices() const {
+    return vertices;
+}
+
+std::span<const uint16_t> MeshCache::getIndices() const {
+    return indices;
+}
+
+std::span<const SubMesh> MeshCache::getSubMeshes() const {
+    return submeshes;
+}
+
+const std::vector<std::string>& MeshCache::getMaterialPath() const {
+    return material_path;
+}
+
+bool MeshCache::hasImage() const {
+    return !this->material_path.empty();
+}
+
+bool MeshCache::isTextured() const {
+    return textured;
+}
+
+bool MeshCache::isOptimized() const {
+    return optimized;
+}
+
+bool MeshCache::isMapped() const {
+    return file.has_value();
+}
+
+std::ostream& operator<<(std::ostream& os, const MeshCache& mesh) {
+    os << "Mesh " << (mesh.isMapped() ? "mapped from cache" : "built from model") << std::endl;
+    os << "Geometry: " << mesh.getVertices().size() << " vertices, " << mesh.getIndices().size() << " indices in " << mesh.getSubMeshes().size() << " draws";
+    os << (mesh.isTextured() ? " (model uv)" : " (flat)") << std::endl;
+    os << "Vertex cache optimisation: " << (mesh.isOptimized() ? "yes" : "no") << std::endl;
+    os << "Material files: " << mesh.getMaterialPath().size();
+
+    return os;
+}
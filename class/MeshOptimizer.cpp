@@ -0,0 +1,234 @@
+#include "../include/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// The cache Tipsify optimises for, smaller than the simulated one so it holds on older hardware too
+static constexpr size_t TIPSIFY_CACHE_SIZE = 16;
+
+// Tipsify: fans around a vertex, then moves on to the cached neighbour that will still be in the cache
+// after its remaining triangles are emitted, or jumps back through the recently used vertices when
+// there is none. Every jump starts a cluster, the starting triangle of each is written to `clusters`.
+static std::vector<uint32_t> tipsify(std::span<const uint32_t> indices, size_t vertex_count, std::vector<size_t>& clusters) {
+    const size_t triangle_count = indices.size() / 3;
+
+    // triangles around each vertex, as a compressed adjacency list
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (const uint32_t index : indices)
+        offsets[index + 1]++;
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t corner = 0; corner < indices.size(); corner++)
+        adjacency[cursor[indices[corner]]++] = static_cast<uint32_t>(corner / 3);
+
+    std::vector<uint32_t> live(vertex_count);
+    for (size_t vertex = 0; vertex < vertex_count; vertex++)
+        live[vertex] = offsets[vertex + 1] - offsets[vertex];
+
+    std::vector<size_t> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> dead_end;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+
+    output.reserve(indices.size());
+    clusters.clear();
+
+    size_t time = TIPSIFY_CACHE_SIZE + 1;
+    size_t scan = 0;
+    int64_t fanning = vertex_count > 0 ? 0 : -1;
+    bool jumped = true;
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        for (uint32_t edge = offsets[fanning]; edge < offsets[fanning + 1]; edge++) {
+            const uint32_t triangle = adjacency[edge];
+
+            if (emitted[triangle])
+                continue;
+
+            if (jumped) {
+                clusters.push_back(output.size() / 3);
+                jumped = false;
+            }
+
+            for (size_t corner = 0; corner < 3; corner++) {
+                const uint32_t vertex = indices[triangle * 3 + corner];
+
+                output.push_back(vertex);
+                dead_end.push_back(vertex);
+                candidates.push_back(vertex);
+                live[vertex]--;
+
+                if (time - cache_time[vertex] > TIPSIFY_CACHE_SIZE) {
+                    cache_time[vertex] = time;
+                    time++;
+                }
+            }
+
+            emitted[triangle] = true;
+        }
+
+        // the candidate staying in the cache the longest once its own fan is emitted
+        fanning = -1;
+        size_t best = 0;
+
+        for (const uint32_t vertex : candidates) {
+            if (live[vertex] == 0)
+                continue;
+
+            size_t priority = 0;
+            if (time - cache_time[vertex] + 2 * live[vertex] <= TIPSIFY_CACHE_SIZE)
+                priority = time - cache_time[vertex];
+
+            if (fanning == -1 || priority > best) {
+                fanning = vertex;
+                best = priority;
+            }
+        }
+
+        if (fanning != -1)
+            continue;
+
+        jumped = true;
+
+        while (dead_end.empty() == false && fanning == -1) {
+            const uint32_t vertex = dead_end.back();
+            dead_end.pop_back();
+
+            if (live[vertex] > 0)
+                fanning = vertex;
+        }
+
+        while (scan < vertex_count && fanning == -1) {
+            if (live[scan] > 0)
+                fanning = static_cast<int64_t>(scan);
+            scan++;
+        }
+    }
+
+    return output;
+}
+
+// Draws the clusters whose triangles face away from the middle of the mesh first, they are the ones
+// most likely to hide the rest (the fast overdraw ordering from the Tipsify paper)
+static void sortClusters(std::vector<uint32_t>& indices, std::span<const size_t> clusters, const std::vector<Vertex>& vertices) {
+    const size_t triangle_count = indices.size() / 3;
+
+    if (clusters.size() < 2)
+        return;
+
+    float center[3] = {0.0f, 0.0f, 0.0f};
+    for (const auto& vertex : vertices) {
+        center[0] += vertex.pos.x;
+        center[1] += vertex.pos.y;
+        center[2] += vertex.pos.z;
+    }
+    for (float& axis : center)
+        axis /= static_cast<float>(vertices.size());
+
+    std::vector<std::pair<float, size_t>> order;
+    order.reserve(clusters.size());
+
+    for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+        const size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangle_count;
+        float centroid[3] = {0.0f, 0.0f, 0.0f};
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+        float area = 0.0f;
+
+        for (size_t triangle = clusters[cluster]; triangle < end; triangle++) {
+            const auto& a = vertices[indices[triangle * 3]].pos;
+            const auto& b = vertices[indices[triangle * 3 + 1]].pos;
+            const auto& c = vertices[indices[triangle * 3 + 2]].pos;
+
+            // area weighted normal and centroid
+            const float x = (b.y - a.y) * (c.z - a.z) - (b.z - a.z) * (c.y - a.y);
+            const float y = (b.z - a.z) * (c.x - a.x) - (b.x - a.x) * (c.z - a.z);
+            const float z = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+            const float weight = std::sqrt(x * x + y * y + z * z);
+
+            normal[0] += x;
+            normal[1] += y;
+            normal[2] += z;
+            centroid[0] += (a.x + b.x + c.x) * weight;
+            centroid[1] += (a.y + b.y + c.y) * weight;
+            centroid[2] += (a.z + b.z + c.z) * weight;
+            area += weight;
+        }
+
+        float outward = 0.0f;
+        if (area > 0.0f) {
+            for (int axis = 0; axis < 3; axis++)
+                outward += (centroid[axis] / (3.0f * area) - center[axis]) * normal[axis] / area;
+        }
+
+        order.emplace_back(-outward, cluster);
+    }
+
+    std::ranges::stable_sort(order);
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(indices.size());
+
+    for (const auto& [outward, cluster] : order) {
+        const size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangle_count;
+        sorted.insert(sorted.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + end * 3);
+    }
+
+    indices = std::move(sorted);
+}
+
+// Renumbers the vertices in the order the index buffer first uses them so fetching them walks memory forward
+static void reorderVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    constexpr uint32_t UNUSED = UINT32_MAX;
+
+    std::vector<uint32_t> remap(vertices.size(), UNUSED);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+}
+
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    if (indices.size() < 3)
+        return;
+
+    std::vector<size_t> clusters;
+
+    indices = tipsify(indices, vertices.size(), clusters);
+    sortClusters(indices, clusters, vertices);
+    reorderVertices(vertices, indices);
+}
+
+float computeACMR(std::span<const uint32_t> indices, size_t cache_size) {
+    if (indices.size() < 3)
+        return 0.0f;
+
+    const uint32_t vertex_count = *std::ranges::max_element(indices) + 1;
+
+    // a vertex is cached while fewer than `cache_size` misses happened since it was loaded
+    std::vector<size_t> loaded(vertex_count, 0);
+    size_t misses = 0;
+
+    for (const uint32_t index : indices) {
+        if (loaded[index] == 0 || misses - loaded[index] >= cache_size) {
+            misses++;
+            loaded[index] = misses;
+        }
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
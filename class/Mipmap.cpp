@@ -0,0 +1,88 @@
+#include "../include/Mipmap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+static constexpr size_t ALIGNMENT = 16;
+
+static float toLinear(uint8_t value) {
+    const float c = static_cast<float>(value) / 255.0f;
+
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t toSrgb(float value) {
+    const float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+
+    return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+uint32_t getMipLevels(uint32_t width, uint32_t height) {
+    return static_cast<uint32_t>(std::bit_width(std::max({width, height, 1u})));
+}
+
+std::vector<MipLevel> getMipChain(uint32_t width, uint32_t height) {
+    std::vector<MipLevel> levels(getMipLevels(width, height));
+    size_t offset = 0;
+
+    for (auto& level: levels) {
+        level = {width, height, offset, static_cast<size_t>(width) * height * 4};
+        offset = (offset + level.size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    return levels;
+}
+
+void buildMipChain(uint8_t* chain, std::span<const MipLevel> levels) {
+    std::array<float, 256> linear{};
+    for (size_t value = 0; value < linear.size(); value++)
+        linear[value] = toLinear(static_cast<uint8_t>(value));
+
+    for (size_t index = 1; index < levels.size(); index++) {
+        const MipLevel& source = levels[index - 1];
+        const MipLevel& target = levels[index];
+        const uint8_t* from = chain + source.offset;
+        uint8_t* to = chain + target.offset;
+
+        // the source texels covered by target texel t along an axis: [t * ratio, (t + 1) * ratio), where the
+        // last texel also takes the odd one left over
+        const auto span = [](uint32_t texel, uint32_t source, uint32_t target) {
+            const uint32_t begin = texel * (source / target);
+            const uint32_t end = texel + 1 == target ? source : begin + source / target;
+            return std::pair(begin, end);
+        };
+
+        for (uint32_t y = 0; y < target.height; y++) {
+            const auto [top, bottom] = span(y, source.height, target.height);
+
+            for (uint32_t x = 0; x < target.width; x++) {
+                const auto [left, right] = span(x, source.width, target.width);
+                float sum[4] = {};
+
+                for (uint32_t sy = top; sy < bottom; sy++) {
+                    const uint8_t* texel = from + (static_cast<size_t>(sy) * source.width + left) * 4;
+
+                    for (uint32_t sx = left; sx < right; sx++, texel += 4) {
+                        sum[0] += linear[texel[0]];
+                        sum[1] += linear[texel[1]];
+                        sum[2] += linear[texel[2]];
+                        sum[3] += texel[3];
+                    }
+                }
+
+                const float weight = 1.0f / static_cast<float>((bottom - top) * (right - left));
+                uint8_t* out = to + (static_cast<size_t>(y) * target.width + x) * 4;
+
+                out[0] = toSrgb(sum[0] * weight);
+                out[1] = toSrgb(sum[1] * weight);
+                out[2] = toSrgb(sum[2] * weight);
+                out[3] = static_cast<uint8_t>(sum[3] * weight + 0.5f);
+            }
+        }
+    }
+}
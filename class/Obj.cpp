@@ -1,21 +1,27 @@
 #include "../include/Obj.hpp"
+#include "../include/MappedFile.hpp"
+#include "../include/ThreadPool.hpp"
 
 #include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <cstring>
 
-Face::Face() = default;
+Face::Face(const std::span<const int> vertices, const std::span<const int> textures, const std::span<const int> normals) : vertices_index(vertices), textures_index(textures), normals_index(normals) {
+
+}
 
 Face::~Face() = default;
 
-const std::vector<int>& Face::getVerticesIndex() const {
+std::span<const int> Face::getVerticesIndex() const {
     return vertices_index;
 }
 
-const std::vector<int>& Face::getTexturesIndex() const {
+std::span<const int> Face::getTexturesIndex() const {
     return textures_index;
 }
 
-const std::vector<int>& Face::getNormalsIndex() const {
+std::span<const int> Face::getNormalsIndex() const {
     return normals_index;
 }
 
@@ -31,22 +37,10 @@ int Face::getNormalIndex(const int index) const {
     return normals_index[index];
 }
 
-void Face::addVerticesIndex(const int vertices) {
-    vertices_index.push_back(vertices);
-}
-
-void Face::addTexturesIndex(const int textures) {
-    textures_index.push_back(textures);
-}
-
-void Face::addNormalsIndex(const int normals) {
-    normals_index.push_back(normals);
-}
-
 std::ostream& operator<<(std::ostream& os, const Face& face) {
-    auto &vertices = face.getVerticesIndex();
-    auto &textures = face.getTexturesIndex();
-    auto &normals = face.getNormalsIndex();
+    const auto vertices = face.getVerticesIndex();
+    const auto textures = face.getTexturesIndex();
+    const auto normals = face.getNormalsIndex();
 
     for (int index = 0; index < vertices.size(); ++index) {
         os << vertices[index] << "/" << textures[index] << "/" << normals[index];
@@ -57,6 +51,52 @@ std::ostream& operator<<(std::ostream& os, const Face& face) {
     return os;
 }
 
+FaceList::iterator::iterator(const FaceList* list, const size_t index) : list(list), index(index) {
+
+}
+
+Face FaceList::iterator::operator*() const {
+    return (*list)[index];
+}
+
+FaceList::iterator& FaceList::iterator::operator++() {
+    ++index;
+    return *this;
+}
+
+FaceList::iterator FaceList::iterator::operator++(int) {
+    iterator copy = *this;
+    ++index;
+    return copy;
+}
+
+FaceList::FaceList(const std::span<const uint32_t> offsets, const std::span<const int> vertices, const std::span<const int> textures, const std::span<const int> normals) : offsets(offsets), vertices_index(vertices), textures_index(textures), normals_index(normals) {
+
+}
+
+size_t FaceList::size() const {
+    return offsets.size() - 1;
+}
+
+bool FaceList::empty() const {
+    return this->size() == 0;
+}
+
+Face FaceList::operator[](const size_t index) const {
+    const uint32_t first = offsets[index];
+    const uint32_t count = offsets[index + 1] - first;
+
+    return {vertices_index.subspan(first, count), textures_index.subspan(first, count), normals_index.subspan(first, count)};
+}
+
+FaceList::iterator FaceList::begin() const {
+    return {this, 0};
+}
+
+FaceList::iterator FaceList::end() const {
+    return {this, this->size()};
+}
+
 
 void Obj::parseVertex(const std::string &line) {
     float x, y, z;
@@ -83,7 +123,6 @@ void Obj::parseNormal(const std::string &line) {
 }
 
 void Obj::parseFace(const std::string &line) {
-    Face face;
     std::istringstream iss(line);
     std::string type; // for the "f"
     iss >> type;
@@ -95,21 +134,21 @@ void Obj::parseFace(const std::string &line) {
         int vertexIdx, texCoordIdx, normalIdx = 0;
 
         if (tokenStream >> vertexIdx)
-            face.addVerticesIndex(vertexIdx);
+            face_vertices.push_back(vertexIdx);
         else
-            face.addVerticesIndex(0);
+            face_vertices.push_back(0);
 
         if (tokenStream >> texCoordIdx)
-            face.addTexturesIndex(texCoordIdx);
+            face_textures.push_back(texCoordIdx);
         else
-            face.addTexturesIndex(0);
+            face_textures.push_back(0);
 
         if (tokenStream >> normalIdx)
-            face.addNormalsIndex(normalIdx);
+            face_normals.push_back(normalIdx);
         else
-            face.addNormalsIndex(0);
+            face_normals.push_back(0);
     }
-    faces.push_back(face);
+    face_offsets.push_back(static_cast<uint32_t>(face_vertices.size()));
 }
 
 void Obj::parseMaterial(const std::string &line, std::string path_obj) {
@@ -122,7 +161,115 @@ void Obj::parseMaterial(const std::string &line, std::string path_obj) {
 }
 
 
-Obj::Obj(const std::string& path) {
+static bool isBlank(const char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skipBlank(const char* it, const char* end) {
+    while (it != end && isBlank(*it))
+        ++it;
+    return it;
+}
+
+static const char* parseFloat(const char* it, const char* end, float& value) {
+    it = skipBlank(it, end);
+    if (it != end && *it == '+')
+        ++it;
+
+    auto [ptr, error] = std::from_chars(it, end, value);
+    if (error != std::errc())
+        value = 0.0f;
+
+    return ptr;
+}
+
+static const char* parseIndex(const char* it, const char* end, int& value) {
+    auto [ptr, error] = std::from_chars(it, end, value);
+    if (error != std::errc())
+        value = 0;
+
+    return ptr;
+}
+
+// obj indices are 1-based, negative ones are relative to the current end of the list
+static int resolveIndex(const int index, const size_t count) {
+    if (index < 0)
+        return static_cast<int>(count) + index + 1;
+    return index;
+}
+
+void Obj::parseBuffer(const std::string_view buffer, const std::string& path) {
+    const char* it = buffer.data();
+    const char* const end = buffer.data() + buffer.size();
+
+    while (it != end) {
+        const char* line_end = static_cast<const char*>(std::memchr(it, '\n', end - it));
+        if (line_end == nullptr)
+            line_end = end;
+
+        const char* cursor = skipBlank(it, line_end);
+        const char* type_end = cursor;
+        while (type_end != line_end && !isBlank(*type_end))
+            ++type_end;
+
+        const std::string_view type(cursor, type_end - cursor);
+        cursor = type_end;
+
+        if (type == "v") {
+            float x, y, z;
+            cursor = parseFloat(cursor, line_end, x);
+            cursor = parseFloat(cursor, line_end, y);
+            parseFloat(cursor, line_end, z);
+            vertices.emplace_back(x, y, z);
+        } else if (type == "vt") {
+            float x, y;
+            cursor = parseFloat(cursor, line_end, x);
+            parseFloat(cursor, line_end, y);
+            texture_coordinates.emplace_back(x, y);
+        } else if (type == "vn") {
+            float x, y, z;
+            cursor = parseFloat(cursor, line_end, x);
+            cursor = parseFloat(cursor, line_end, y);
+            parseFloat(cursor, line_end, z);
+            normals.emplace_back(x, y, z);
+        } else if (type == "f") {
+            while ((cursor = skipBlank(cursor, line_end)) != line_end) {
+                int vertexIdx = 0, texCoordIdx = 0, normalIdx = 0;
+
+                cursor = parseIndex(cursor, line_end, vertexIdx);
+                if (cursor != line_end && *cursor == '/') {
+                    ++cursor;
+                    if (cursor != line_end && *cursor != '/')
+                        cursor = parseIndex(cursor, line_end, texCoordIdx);
+                    if (cursor != line_end && *cursor == '/')
+                        cursor = parseIndex(cursor + 1, line_end, normalIdx);
+                }
+
+                while (cursor != line_end && !isBlank(*cursor))
+                    ++cursor;
+
+                const size_t corner = face_vertices.size();
+                if (vertexIdx < 0)
+                    relative_indices.push_back({corner, 0});
+                if (texCoordIdx < 0)
+                    relative_indices.push_back({corner, 1});
+                if (normalIdx < 0)
+                    relative_indices.push_back({corner, 2});
+
+                face_vertices.push_back(resolveIndex(vertexIdx, vertices.size()));
+                face_textures.push_back(resolveIndex(texCoordIdx, texture_coordinates.size()));
+                face_normals.push_back(resolveIndex(normalIdx, normals.size()));
+            }
+            face_offsets.push_back(static_cast<uint32_t>(face_vertices.size()));
+        } else if (type == "mtllib") {
+            this->parseMaterial(std::string(it, line_end), path);
+        }
+
+        it = line_end == end ? end : line_end + 1;
+    }
+}
+
+void Obj::loadStream(const std::string& path) {
     std::ifstream file(path);
 
     if (!file.is_open()) {
@@ -150,6 +297,133 @@ Obj::Obj(const std::string& path) {
     }
 }
 
+void Obj::loadMapped(const std::string& path) {
+    const MappedFile file(path);
+
+    this->parseBuffer(file.getView(), path);
+}
+
+void Obj::loadParallel(const std::string& path, const unsigned int threads) {
+    // below this a chunk costs more to schedule than to parse
+    constexpr size_t minimum_chunk_size = 256 * 1024;
+
+    const MappedFile file(path);
+    const std::string_view buffer = file.getView();
+
+    const unsigned int worker_count = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    const size_t chunk_count = std::clamp<size_t>(buffer.size() / minimum_chunk_size, 1, worker_count * 4);
+
+    if (chunk_count == 1) {
+        this->parseBuffer(buffer, path);
+        return;
+    }
+
+    ThreadPool pool(worker_count);
+
+    std::vector<std::string_view> chunks;
+    size_t begin = 0;
+
+    for (size_t index = 1; index <= chunk_count && begin < buffer.size(); index++) {
+        size_t end = buffer.size();
+
+        if (index != chunk_count) {
+            end = buffer.find('\n', std::max(begin, buffer.size() * index / chunk_count));
+            end = end == std::string_view::npos ? buffer.size() : end + 1;
+        }
+
+        chunks.push_back(buffer.substr(begin, end - begin));
+        begin = end;
+    }
+
+    std::vector<Obj> parsed;
+    std::vector<std::future<void>> pending;
+    parsed.reserve(chunks.size());
+    pending.reserve(chunks.size());
+
+    for (size_t index = 0; index < chunks.size(); index++)
+        parsed.push_back(Obj());
+
+    for (size_t index = 0; index < chunks.size(); index++)
+        pending.push_back(pool.submit([&, index] { parsed[index].parseBuffer(chunks[index], path); }));
+
+    for (auto& future : pending)
+        future.get();
+
+    // prefix sums give every chunk its slice in the final vectors, so the stitching runs on the pool as well
+    struct Offsets {
+        size_t vertices, textures, normals, faces, corners, materials;
+    };
+
+    std::vector<Offsets> offsets(parsed.size() + 1, Offsets{});
+    for (size_t index = 0; index < parsed.size(); index++) {
+        offsets[index + 1] = {
+            offsets[index].vertices + parsed[index].vertices.size(),
+            offsets[index].textures + parsed[index].texture_coordinates.size(),
+            offsets[index].normals + parsed[index].normals.size(),
+            offsets[index].faces + parsed[index].face_offsets.size() - 1,
+            offsets[index].corners + parsed[index].face_vertices.size(),
+            offsets[index].materials + parsed[index].material_path.size()
+        };
+    }
+
+    vertices.resize(offsets.back().vertices);
+    texture_coordinates.resize(offsets.back().textures);
+    normals.resize(offsets.back().normals);
+    face_offsets.resize(offsets.back().faces + 1);
+    face_vertices.resize(offsets.back().corners);
+    face_textures.resize(offsets.back().corners);
+    face_normals.resize(offsets.back().corners);
+    material_path.resize(offsets.back().materials);
+
+    pending.clear();
+    for (size_t index = 0; index < parsed.size(); index++) {
+        pending.push_back(pool.submit([&, index] {
+            Obj& chunk = parsed[index];
+            const Offsets& offset = offsets[index];
+
+            for (const auto& [corner, attribute] : chunk.relative_indices) {
+                if (attribute == 0)
+                    chunk.face_vertices[corner] += static_cast<int>(offset.vertices);
+                else if (attribute == 1)
+                    chunk.face_textures[corner] += static_cast<int>(offset.textures);
+                else
+                    chunk.face_normals[corner] += static_cast<int>(offset.normals);
+            }
+
+            // the leading 0 of every chunk is already the previous chunk's closing offset
+            for (size_t face = 1; face < chunk.face_offsets.size(); face++)
+                face_offsets[offset.faces + face] = chunk.face_offsets[face] + static_cast<uint32_t>(offset.corners);
+
+            std::ranges::copy(chunk.vertices, vertices.begin() + offset.vertices);
+            std::ranges::copy(chunk.texture_coordinates, texture_coordinates.begin() + offset.textures);
+            std::ranges::copy(chunk.normals, normals.begin() + offset.normals);
+            std::ranges::copy(chunk.face_vertices, face_vertices.begin() + offset.corners);
+            std::ranges::copy(chunk.face_textures, face_textures.begin() + offset.corners);
+            std::ranges::copy(chunk.face_normals, face_normals.begin() + offset.corners);
+            std::ranges::move(chunk.material_path, material_path.begin() + offset.materials);
+        }));
+    }
+
+    for (auto& future : pending)
+        future.get();
+}
+
+Obj::Obj(const std::string& path, const ObjLoader loader, const unsigned int threads) {
+    switch (loader) {
+        case ObjLoader::Stream:
+            this->loadStream(path);
+            break;
+        case ObjLoader::Mapped:
+            this->loadMapped(path);
+            break;
+        case ObjLoader::Parallel:
+            this->loadParallel(path, threads);
+            break;
+    }
+
+    relative_indices.clear();
+}
+
 Obj::~Obj() = default;
 
 const std::vector<cookie::Vector3D<float>>& Obj::getVertices() const {
@@ -164,8 +438,24 @@ const std::vector<cookie::Vector3D<float>>& Obj::getNormals() const {
     return normals;
 }
 
-const std::vector<Face>& Obj::getFaces() const {
-    return faces;
+FaceList Obj::getFaces() const {
+    return {face_offsets, face_vertices, face_textures, face_normals};
+}
+
+const std::vector<uint32_t>& Obj::getFaceOffsets() const {
+    return face_offsets;
+}
+
+const std::vector<int>& Obj::getFaceVerticesIndex() const {
+    return face_vertices;
+}
+
+const std::vector<int>& Obj::getFaceTexturesIndex() const {
+    return face_textures;
+}
+
+const std::vector<int>& Obj::getFaceNormalsIndex() const {
+    return face_normals;
 }
 
 const std::vector<std::string>& Obj::getMaterialPath() const {
@@ -182,7 +472,7 @@ std::ostream& operator<<(std::ostream& os, const Obj& obj) {
     auto &vertices = obj.getVertices();
     auto &texture_coordinates = obj.getTextureCoordinates();
     auto &normals = obj.getNormals();
-    auto &faces = obj.getFaces();
+    const auto faces = obj.getFaces();
     auto &material_path = obj.getMaterialPath();
 
     os << "Vertices: " << vertices.size() << std::endl;
@@ -0,0 +1,111 @@
+#include "../include/Png.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+static constexpr uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+// a stored deflate block holds at most 65535 bytes
+static constexpr size_t STORED_BLOCK = 65535;
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> table{};
+
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+
+        return table;
+    }();
+
+    crc = ~crc;
+    for (size_t index = 0; index < size; index++)
+        crc = table[(crc ^ data[index]) & 0xff] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+static void appendBigEndian(std::vector<uint8_t>& output, uint32_t value) {
+    output.push_back(static_cast<uint8_t>(value >> 24));
+    output.push_back(static_cast<uint8_t>(value >> 16));
+    output.push_back(static_cast<uint8_t>(value >> 8));
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+static void writeChunk(std::ofstream& output, const char type[4], const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+
+    appendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    appendBigEndian(chunk, crc32(chunk.data() + 4, data.size() + 4));
+
+    output.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+}
+
+void writePng(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height) {
+    std::vector<uint8_t> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), {8, 6, 0, 0, 0}); // 8 bit RGBA, deflate, adaptive filtering, no interlace
+
+    // every row is prefixed with its filter type, 0 (none)
+    const size_t stride = static_cast<size_t>(width) * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((stride + 1) * height);
+
+    for (uint32_t y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels + y * stride, pixels + (y + 1) * stride);
+    }
+
+    // zlib stream: header, stored blocks, adler32 of the raw data
+    std::vector<uint8_t> data = {0x78, 0x01};
+    data.reserve(raw.size() + raw.size() / STORED_BLOCK * 5 + 16);
+
+    for (size_t offset = 0; offset < raw.size() || offset == 0; offset += STORED_BLOCK) {
+        const size_t size = std::min(STORED_BLOCK, raw.size() - offset);
+        const bool last = offset + size == raw.size();
+
+        data.push_back(last ? 1 : 0);
+        data.push_back(static_cast<uint8_t>(size));
+        data.push_back(static_cast<uint8_t>(size >> 8));
+        data.push_back(static_cast<uint8_t>(~size));
+        data.push_back(static_cast<uint8_t>(~size >> 8));
+        data.insert(data.end(), raw.begin() + static_cast<std::ptrdiff_t>(offset), raw.begin() + static_cast<std::ptrdiff_t>(offset + size));
+
+        if (last)
+            break;
+    }
+
+    uint32_t a = 1, b = 0;
+    for (const uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(data, b << 16 | a);
+
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+
+    if (!output) {
+        throw std::runtime_error("failed to create " + path);
+    }
+
+    output.write(reinterpret_cast<const char*>(SIGNATURE), sizeof(SIGNATURE));
+    writeChunk(output, "IHDR", header);
+    writeChunk(output, "IDAT", data);
+    writeChunk(output, "IEND", {});
+
+    output.close();
+
+    if (!output) {
+        throw std::runtime_error("failed to write " + path);
+    }
+}
@@ -0,0 +1,98 @@
+#include "../include/Profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+std::atomic<bool> Profiler::enabled = false;
+
+static std::mutex mutex;
+static std::vector<std::unique_ptr<Profiler::Ring>> rings;
+static Profiler::clock::time_point origin;
+
+static thread_local Profiler::Ring* threadRing = nullptr;
+
+static int64_t nanoseconds(Profiler::clock::time_point point) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(point.time_since_epoch()).count();
+}
+
+// only the first zone of a thread locks, to register its ring
+Profiler::Ring& Profiler::getRing() {
+    if (threadRing == nullptr) {
+        std::lock_guard lock(mutex);
+
+        rings.push_back(std::make_unique<Ring>());
+        rings.back()->thread = static_cast<uint32_t>(rings.size());
+        threadRing = rings.back().get();
+    }
+
+    return *threadRing;
+}
+
+void Profiler::start() {
+    origin = clock::now();
+    getRing();
+
+    enabled.store(true, std::memory_order_release);
+}
+
+void Profiler::record(const char* name, clock::time_point begin, clock::time_point end) {
+    Ring& ring = getRing();
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+
+    ring.events[head % RING_SIZE] = {name, nanoseconds(begin), nanoseconds(end)};
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::write(const std::string& path) {
+    enabled.store(false, std::memory_order_relaxed);
+
+    std::ofstream output(path, std::ios::trunc);
+
+    if (!output) {
+        throw std::runtime_error("failed to create trace file!");
+    }
+
+    const int64_t start = nanoseconds(origin);
+
+    // trace event timestamps are in microseconds
+    const auto microseconds = [](int64_t nanoseconds) {
+        return std::to_string(nanoseconds / 1000) + "." + std::to_string(1000 + nanoseconds % 1000).substr(1);
+    };
+
+    std::lock_guard lock(mutex);
+
+    output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+
+    for (const auto& ring : rings) {
+        const std::string thread = ring->thread == 1 ? "main" : "thread " + std::to_string(ring->thread);
+
+        output << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->thread
+               << ",\"args\":{\"name\":\"" << thread << "\"}}";
+        first = false;
+
+        const uint64_t head = ring->head.load(std::memory_order_acquire);
+
+        for (uint64_t index = head > RING_SIZE ? head - RING_SIZE : 0; index < head; index++) {
+            const Event& event = ring->events[index % RING_SIZE];
+
+            // zones opened before start are cut at the start of the trace
+            const int64_t begin = std::max(event.begin, start) - start;
+            const int64_t end = std::max(event.end, start) - start;
+
+            output << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"scope\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->thread
+                   << ",\"ts\":" << microseconds(begin) << ",\"dur\":" << microseconds(end - begin) << "}";
+        }
+    }
+
+    output << "\n]}" << std::endl;
+
+    if (!output) {
+        throw std::runtime_error("failed to write trace file!");
+    }
+}
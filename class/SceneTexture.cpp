@@ -0,0 +1,62 @@
+#include "../include/SceneTexture.hpp"
+#include "../include/stb_image.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+void decodeTexture(SceneTexture& texture) {
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load(texture.path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+    if (!pixels) {
+        throw std::runtime_error("failed to load texture image!");
+    }
+
+    texture.width = static_cast<uint32_t>(texWidth);
+    texture.height = static_cast<uint32_t>(texHeight);
+    texture.pixels.resize(static_cast<size_t>(texture.width) * texture.height * 4);
+
+    std::memcpy(texture.pixels.data(), pixels, texture.pixels.size());
+    stbi_image_free(pixels);
+}
+
+void loadTexture(SceneTexture& texture, std::optional<TextureFormat> compression, bool cache, bool verbose) {
+    if (compression.has_value() == false) {
+        if (verbose)
+            std::cout << "Loading: " << texture.path << std::endl;
+
+        decodeTexture(texture);
+        return;
+    }
+
+    if (cache) {
+        try {
+            texture.compressed.emplace(texture.path);
+
+            if (texture.compressed->getFormat() != compression.value()) {
+                if (verbose)
+                    std::cout << "Texture cache not used: compressed to another format" << std::endl;
+                texture.compressed.reset();
+            }
+        } catch (std::exception &error) {
+            if (verbose)
+                std::cout << "Texture cache not used: " << error.what() << std::endl;
+        }
+    }
+
+    if (texture.compressed.has_value() == false) {
+        texture.compressed.emplace(texture.path, compression.value(), verbose);
+
+        if (cache) {
+            try {
+                texture.compressed->save(texture.path);
+            } catch (std::exception &error) {
+                std::cerr << "Failed to write texture cache: " << error.what() << std::endl;
+            }
+        }
+    }
+
+    if (verbose)
+        std::cout << texture.compressed.value() << std::endl;
+}
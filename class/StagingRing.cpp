@@ -0,0 +1,156 @@
+#include "../include/StagingRing.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+StagingRing::StagingRing(VkDevice device, MemoryAllocator& allocator, VkDeviceSize capacity) : device(device), allocator(allocator), capacity(capacity) {
+    this->createBuffer(capacity, this->buffer, this->memory);
+}
+
+StagingRing::~StagingRing() {
+    this->wait();
+
+    for (auto& [overflow, overflowMemory]: this->pendingOverflow) {
+        vkDestroyBuffer(this->device, overflow, nullptr);
+        this->allocator.free(overflowMemory);
+    }
+
+    for (auto fence: this->fences)
+        vkDestroyFence(this->device, fence, nullptr);
+
+    vkDestroyBuffer(this->device, this->buffer, nullptr);
+    this->allocator.free(this->memory);
+}
+
+void StagingRing::createBuffer(VkDeviceSize size, VkBuffer& buffer, Allocation& memory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(this->device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create staging buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(this->device, buffer, &memRequirements);
+
+    memory = this->allocator.allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+
+    vkBindBufferMemory(this->device, buffer, memory.memory, memory.offset);
+}
+
+bool StagingRing::place(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+    // start over from 0 once idle, while something is in flight its end is where tail will move to
+    if (this->head == this->tail && this->inFlight.empty())
+        this->head = this->tail = 0;
+
+    const VkDeviceSize aligned = (this->head + alignment - 1) / alignment * alignment;
+
+    // the free space is [head, capacity) then [0, tail) while the used part has not wrapped, [head, tail)
+    // once it has. A region never ends on tail, head == tail has to keep meaning empty
+    if (this->head >= this->tail) {
+        if (aligned + size <= this->capacity) {
+            offset = aligned;
+        } else if (size < this->tail) {
+            offset = 0;
+        } else {
+            return false;
+        }
+    } else if (aligned + size < this->tail) {
+        offset = aligned;
+    } else {
+        return false;
+    }
+
+    this->head = offset + size;
+    return true;
+}
+
+void StagingRing::retire() {
+    Submission& submission = this->inFlight.front();
+
+    this->tail = submission.end;
+    this->completed = submission.serial;
+
+    for (auto& [overflow, overflowMemory]: submission.overflow) {
+        vkDestroyBuffer(this->device, overflow, nullptr);
+        this->allocator.free(overflowMemory);
+    }
+
+    vkResetFences(this->device, 1, &submission.fence);
+    this->fences.push_back(submission.fence);
+
+    this->inFlight.pop_front();
+}
+
+StagingRegion StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    size = std::max<VkDeviceSize>(size, 1);
+
+    this->reclaim();
+
+    VkDeviceSize offset;
+
+    if (size <= this->capacity) {
+        while (true) {
+            if (this->place(size, alignment, offset))
+                return {this->buffer, offset, static_cast<char*>(this->memory.mapped) + offset};
+
+            // only unsubmitted uploads are left in the way, waiting would never free them
+            if (this->inFlight.empty())
+                break;
+
+            vkWaitForFences(this->device, 1, &this->inFlight.front().fence, VK_TRUE, UINT64_MAX);
+            this->retire();
+        }
+    }
+
+    VkBuffer overflow;
+    Allocation overflowMemory;
+    this->createBuffer(size, overflow, overflowMemory);
+    this->pendingOverflow.emplace_back(overflow, overflowMemory);
+
+    return {overflow, 0, overflowMemory.mapped};
+}
+
+VkFence StagingRing::submit() {
+    VkFence fence;
+
+    if (this->fences.empty()) {
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(this->device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create staging fence!");
+        }
+    } else {
+        fence = this->fences.back();
+        this->fences.pop_back();
+    }
+
+    this->inFlight.push_back({++this->submitted, fence, this->head, std::move(this->pendingOverflow)});
+    this->pendingOverflow.clear();
+
+    return fence;
+}
+
+void StagingRing::reclaim() {
+    while (this->inFlight.empty() == false && vkGetFenceStatus(this->device, this->inFlight.front().fence) == VK_SUCCESS)
+        this->retire();
+}
+
+void StagingRing::wait() {
+    while (this->inFlight.empty() == false) {
+        vkWaitForFences(this->device, 1, &this->inFlight.front().fence, VK_TRUE, UINT64_MAX);
+        this->retire();
+    }
+}
+
+uint64_t StagingRing::getSubmitted() const {
+    return this->submitted;
+}
+
+bool StagingRing::isComplete(uint64_t serial) const {
+    return serial <= this->completed;
+}
@@ -0,0 +1,49 @@
+#include "../include/StartupTimeline.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+StartupTimeline::StartupTimeline() : origin(clock::now()) {}
+
+void StartupTimeline::record(const std::string& name, clock::time_point begin, clock::time_point end) {
+    std::lock_guard lock(this->mutex);
+
+    this->spans.push_back({name, begin, end});
+}
+
+std::ostream& operator<<(std::ostream& os, const StartupTimeline& timeline) {
+    constexpr size_t WIDTH = 48;
+
+    std::vector<StartupTimeline::Span> spans;
+    {
+        std::lock_guard lock(timeline.mutex);
+        spans = timeline.spans;
+    }
+
+    std::ranges::sort(spans, {}, &StartupTimeline::Span::begin);
+
+    const auto milliseconds = [&timeline](StartupTimeline::clock::time_point point) {
+        return std::chrono::duration<double, std::milli>(point - timeline.origin).count();
+    };
+
+    double total = 0.0;
+    for (const auto& span : spans)
+        total = std::max(total, milliseconds(span.end));
+
+    os << "Startup timeline: " << std::fixed << std::setprecision(1) << total << " ms";
+
+    // one bar per task on a shared time axis, the overlapping ones ran concurrently
+    for (const auto& span : spans) {
+        const double begin = milliseconds(span.begin);
+        const double end = milliseconds(span.end);
+        const size_t first = total > 0.0 ? std::min(static_cast<size_t>(std::lround(begin / total * WIDTH)), WIDTH - 1) : 0;
+        const size_t last = std::max(first + 1, total > 0.0 ? static_cast<size_t>(std::lround(end / total * WIDTH)) : WIDTH);
+
+        os << std::endl << "  " << std::left << std::setw(16) << span.name << std::right
+           << std::setw(9) << begin << " -> " << std::setw(9) << end << " ms  |"
+           << std::string(first, ' ') << std::string(std::min(last, WIDTH) - first, '#') << std::string(WIDTH - std::min(last, WIDTH), ' ') << "|";
+    }
+
+    return os;
+}
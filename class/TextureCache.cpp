@@ -0,0 +1,225 @@
+#include "../include/TextureCache.hpp"
+#include "../include/ThreadPool.hpp"
+#include "../include/stb_image.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+static constexpr char MAGIC[8] = {'S', 'C', 'O', 'P', 'E', 'T', 'E', 'X'};
+static constexpr uint32_t VERSION = 1;
+static constexpr uint32_t MAX_LEVELS = 32;
+static constexpr uint64_t ALIGNMENT = 16;
+
+// On-disk layout: this header then the blocks of every level, each starting on a 16 byte boundary. Level
+// offsets are relative to data_offset, where the blocks of level 0 start
+struct TextureCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    uint32_t reserved;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t source_hash;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint64_t level_offset[MAX_LEVELS];
+    uint64_t level_size[MAX_LEVELS];
+};
+
+static uint64_t align(uint64_t offset) {
+    return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+TextureCache::TextureCache(const std::string& path) {
+    const FileStamp stamp = stampFile(path);
+
+    this->file.emplace(getCachePath(path));
+
+    const char* bytes = this->file->getData();
+    const uint64_t size = this->file->getSize();
+
+    TextureCacheHeader header{};
+
+    if (size < sizeof(header)) {
+        throw std::runtime_error("texture cache is truncated");
+    }
+
+    std::memcpy(&header, bytes, sizeof(header));
+
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+        || (header.format != static_cast<uint32_t>(TextureFormat::BC1) && header.format != static_cast<uint32_t>(TextureFormat::BC7))) {
+        throw std::runtime_error("texture cache has an unknown format");
+    }
+
+    if (header.source_size != stamp.size) {
+        throw std::runtime_error("texture cache is out of date");
+    }
+
+    // a touched or copied image keeps its cache as long as the content did not change
+    if (header.source_mtime != stamp.mtime && header.source_hash != hashFile(path)) {
+        throw std::runtime_error("texture cache is out of date");
+    }
+
+    if (header.data_offset % ALIGNMENT != 0 || header.data_offset > size || header.data_size > size - header.data_offset) {
+        throw std::runtime_error("texture cache is truncated");
+    }
+
+    if (header.width == 0 || header.height == 0 || header.level_count != getMipLevels(header.width, header.height)) {
+        throw std::runtime_error("texture cache is corrupted");
+    }
+
+    this->format = static_cast<TextureFormat>(header.format);
+    this->width = header.width;
+    this->height = header.height;
+    this->data = {reinterpret_cast<const uint8_t*>(bytes + header.data_offset), header.data_size};
+
+    for (const MipLevel& level : getMipChain(header.width, header.height)) {
+        const size_t index = this->levels.size();
+        const uint64_t offset = header.level_offset[index];
+        const uint64_t expected = getCompressedSize(this->format, level.width, level.height);
+
+        if (header.level_size[index] != expected || offset % ALIGNMENT != 0 || offset > header.data_size || expected > header.data_size - offset) {
+            throw std::runtime_error("texture cache is corrupted");
+        }
+
+        this->levels.push_back({level.width, level.height, offset, expected});
+    }
+}
+
+TextureCache::TextureCache(const std::string& path, TextureFormat format, bool verbose) : format(format) {
+    const auto start = std::chrono::steady_clock::now();
+
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+
+    if (!pixels) {
+        throw std::runtime_error("failed to load texture image!");
+    }
+
+    this->width = static_cast<uint32_t>(texWidth);
+    this->height = static_cast<uint32_t>(texHeight);
+
+    const std::vector<MipLevel> chain = getMipChain(this->width, this->height);
+    std::vector<uint8_t> rgba(chain.back().offset + chain.back().size);
+
+    std::memcpy(rgba.data(), pixels, chain.front().size);
+    stbi_image_free(pixels);
+
+    buildMipChain(rgba.data(), chain);
+
+    uint64_t offset = 0;
+
+    for (const MipLevel& level : chain) {
+        const size_t size = getCompressedSize(format, level.width, level.height);
+
+        this->levels.push_back({level.width, level.height, offset, size});
+        offset = align(offset + size);
+    }
+
+    this->data_storage.resize(this->levels.back().offset + this->levels.back().size);
+
+    // levels are compressed one after the other, the rows of blocks of a level spread over the pool
+    ThreadPool pool;
+
+    for (size_t index = 0; index < chain.size(); index++)
+        compressImage(format, rgba.data() + chain[index].offset, chain[index].width, chain[index].height, this->data_storage.data() + this->levels[index].offset, pool);
+
+    this->data = this->data_storage;
+
+    if (verbose) {
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Compressed " << path << " to " << (format == TextureFormat::BC1 ? "BC1" : "BC7") << " in " << elapsed.count() << " ms" << std::endl;
+    }
+}
+
+TextureCache::~TextureCache() = default;
+
+void TextureCache::save(const std::string& path) const {
+    const FileStamp stamp = stampFile(path);
+
+    TextureCacheHeader header{};
+
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.format = static_cast<uint32_t>(this->format);
+    header.width = this->width;
+    header.height = this->height;
+    header.level_count = static_cast<uint32_t>(this->levels.size());
+    header.source_size = stamp.size;
+    header.source_mtime = stamp.mtime;
+    header.source_hash = hashFile(path);
+    header.data_offset = align(sizeof(header));
+    header.data_size = this->data.size();
+
+    for (size_t index = 0; index < this->levels.size(); index++) {
+        header.level_offset[index] = this->levels[index].offset;
+        header.level_size[index] = this->levels[index].size;
+    }
+
+    const std::string cache = getCachePath(path);
+    const std::string temporary = cache + ".tmp";
+
+    std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+
+    if (!output) {
+        throw std::runtime_error("failed to create texture cache!");
+    }
+
+    static constexpr char padding[ALIGNMENT] = {};
+
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(padding, static_cast<std::streamsize>(header.data_offset - sizeof(header)));
+    output.write(reinterpret_cast<const char*>(this->data.data()), static_cast<std::streamsize>(this->data.size()));
+
+    output.close();
+
+    if (!output) {
+        std::filesystem::remove(temporary);
+        throw std::runtime_error("failed to write texture cache!");
+    }
+
+    std::filesystem::rename(temporary, cache);
+}
+
+std::string TextureCache::getCachePath(const std::string& path) {
+    return path + ".scopetex";
+}
+
+TextureFormat TextureCache::getFormat() const {
+    return format;
+}
+
+uint32_t TextureCache::getWidth() const {
+    return width;
+}
+
+uint32_t TextureCache::getHeight() const {
+    return height;
+}
+
+const std::vector<MipLevel>& TextureCache::getLevels() const {
+    return levels;
+}
+
+std::span<const uint8_t> TextureCache::getData() const {
+    return data;
+}
+
+bool TextureCache::isMapped() const {
+    return file.has_value();
+}
+
+std::ostream& operator<<(std::ostream& os, const TextureCache& texture) {
+    os << "Texture " << (texture.isMapped() ? "mapped from cache" : "compressed from image") << std::endl;
+    os << "Texture: " << texture.getWidth() << "x" << texture.getHeight() << " " << (texture.getFormat() == TextureFormat::BC1 ? "BC1" : "BC7")
+       << ", " << texture.getLevels().size() << " levels in " << texture.getData().size() << " bytes";
+
+    return os;
+}
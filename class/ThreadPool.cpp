@@ -0,0 +1,44 @@
+#include "../include/ThreadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned int count) {
+    if (count == 0)
+        count = std::max(1u, std::thread::hardware_concurrency());
+
+    this->workers.reserve(count);
+    for (unsigned int index = 0; index < count; index++)
+        this->workers.emplace_back([this] { this->work(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(this->mutex);
+        this->stopping = true;
+    }
+    this->condition.notify_all();
+
+    // join once the queue has been drained, before the mutex and the queue the workers use are destroyed
+    this->workers.clear();
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::move_only_function<void()> task;
+
+        {
+            std::unique_lock lock(this->mutex);
+            this->condition.wait(lock, [this] { return this->stopping || !this->tasks.empty(); });
+
+            if (this->tasks.empty())
+                return;
+
+            task = std::move(this->tasks.front());
+            this->tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+size_t ThreadPool::getSize() const {
+    return workers.size();
+}
@@ -0,0 +1,154 @@
+#include "../include/Triangulator.hpp"
+
+#include <cmath>
+
+// Twice the signed area of (a, b, c), positive when counter-clockwise
+static float cross(float ax, float ay, float bx, float by, float cx, float cy) {
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+Triangulator::Triangulator() = default;
+
+Triangulator::~Triangulator() = default;
+
+void Triangulator::triangulate(std::span<const int> face, const std::vector<cookie::Vector3D<float>>& positions, std::span<const uint32_t> corners, std::vector<uint32_t>& indices) {
+    if (face.size() == 3) {
+        indices.insert(indices.end(), {corners[0], corners[1], corners[2]});
+        return;
+    }
+
+    this->points.clear();
+    for (const int index : face)
+        this->points.push_back(positions[index - 1]);
+
+    this->split(this->points);
+
+    for (const uint32_t corner : this->triangles)
+        indices.push_back(corners[corner]);
+}
+
+void Triangulator::triangulate(std::span<const cookie::Vector3D<float>> polygon, std::vector<uint32_t>& indices) {
+    this->split(polygon);
+    indices.insert(indices.end(), this->triangles.begin(), this->triangles.end());
+}
+
+void Triangulator::split(std::span<const cookie::Vector3D<float>> polygon) {
+    const size_t count = polygon.size();
+
+    this->triangles.clear();
+
+    if (count < 3)
+        return;
+
+    // Newell's method, the normal of the plane that best fits the (possibly non planar) polygon
+    float normal[3] = {0.0f, 0.0f, 0.0f};
+
+    for (size_t corner = 0; corner < count; corner++) {
+        const auto& current = polygon[corner];
+        const auto& following = polygon[(corner + 1) % count];
+
+        normal[0] += (current.y - following.y) * (current.z + following.z);
+        normal[1] += (current.z - following.z) * (current.x + following.x);
+        normal[2] += (current.x - following.x) * (current.y + following.y);
+    }
+
+    // project on the plane of the two other axes, kept in cyclic order so the winding
+    // in 2D has the sign of the dropped normal component
+    int axis = 2;
+    if (std::fabs(normal[0]) > std::fabs(normal[1]) && std::fabs(normal[0]) > std::fabs(normal[2]))
+        axis = 0;
+    else if (std::fabs(normal[1]) > std::fabs(normal[2]))
+        axis = 1;
+
+    const float orientation = normal[axis] < 0.0f ? -1.0f : 1.0f;
+
+    this->u.resize(count);
+    this->v.resize(count);
+
+    for (size_t corner = 0; corner < count; corner++) {
+        const float coordinates[3] = {polygon[corner].x, polygon[corner].y, polygon[corner].z};
+
+        this->u[corner] = coordinates[(axis + 1) % 3];
+        this->v[corner] = coordinates[(axis + 2) % 3];
+    }
+
+    bool convex = normal[axis] != 0.0f;
+
+    for (size_t corner = 0; convex && corner < count; corner++) {
+        const size_t before = (corner + count - 1) % count;
+        const size_t after = (corner + 1) % count;
+
+        convex = cross(u[before], v[before], u[corner], v[corner], u[after], v[after]) * orientation >= 0.0f;
+    }
+
+    // a fan keeps the triangles of convex quads the same as before n-gons were supported,
+    // degenerate polygons (no area) are fanned as well
+    if (convex || normal[axis] == 0.0f) {
+        for (uint32_t corner = 1; corner + 1 < count; corner++)
+            this->triangles.insert(this->triangles.end(), {0, corner, corner + 1});
+        return;
+    }
+
+    this->clip(count, orientation);
+}
+
+void Triangulator::clip(size_t count, float orientation) {
+    this->previous.resize(count);
+    this->next.resize(count);
+
+    for (uint32_t corner = 0; corner < count; corner++) {
+        this->previous[corner] = static_cast<uint32_t>((corner + count - 1) % count);
+        this->next[corner] = static_cast<uint32_t>((corner + 1) % count);
+    }
+
+    size_t remaining = count;
+    size_t tried = 0;
+    uint32_t corner = 0;
+
+    while (remaining > 3) {
+        // after a full turn without an ear the rest is degenerate (self intersecting or collinear),
+        // clip anyway so the polygon still ends up covered
+        if (this->isEar(corner, orientation) || tried >= remaining) {
+            const uint32_t before = this->previous[corner];
+            const uint32_t after = this->next[corner];
+
+            this->triangles.insert(this->triangles.end(), {before, corner, after});
+
+            this->next[before] = after;
+            this->previous[after] = before;
+            remaining--;
+            tried = 0;
+            corner = before;
+        } else {
+            corner = this->next[corner];
+            tried++;
+        }
+    }
+
+    this->triangles.insert(this->triangles.end(), {this->previous[corner], corner, this->next[corner]});
+}
+
+bool Triangulator::isEar(uint32_t corner, float orientation) const {
+    const uint32_t a = this->previous[corner];
+    const uint32_t b = corner;
+    const uint32_t c = this->next[corner];
+
+    if (cross(u[a], v[a], u[b], v[b], u[c], v[c]) * orientation <= 0.0f)
+        return false;
+
+    for (uint32_t other = this->next[c]; other != a; other = this->next[other]) {
+        const float x = u[other];
+        const float y = v[other];
+
+        // a corner sharing the position of the triangle's corners does not block it
+        if ((x == u[a] && y == v[a]) || (x == u[b] && y == v[b]) || (x == u[c] && y == v[c]))
+            continue;
+
+        if (cross(u[a], v[a], u[b], v[b], x, y) * orientation >= 0.0f
+            && cross(u[b], v[b], u[c], v[c], x, y) * orientation >= 0.0f
+            && cross(u[c], v[c], u[a], v[a], x, y) * orientation >= 0.0f)
+            return false;
+    }
+
+    return true;
+}
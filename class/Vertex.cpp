@@ -0,0 +1,74 @@
+#include "../include/Vertex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+uint16_t toHalf(float value) {
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+    const uint16_t sign = (bits >> 16) & 0x8000;
+
+    bits &= 0x7fffffff;
+
+    // too large for a half (or not a number at all)
+    if (bits >= 0x47800000)
+        return sign | (bits > 0x7f800000 ? 0x7e00 : 0x7c00);
+
+    // under the smallest normal half, 2^-14, the subnormal mantissa counts steps of 2^-24
+    if (bits < 0x38800000)
+        return sign | static_cast<uint16_t>(std::lrint(std::bit_cast<float>(bits) * 16777216.0f));
+
+    // rebias the exponent from 127 to 15 and round the 13 dropped mantissa bits to nearest even,
+    // a carry into the exponent is the correctly rounded result (up to infinity)
+    return sign | static_cast<uint16_t>((bits - 0x38000000 + 0xfff + ((bits >> 13) & 1)) >> 13);
+}
+
+VertexBounds packVertices(std::span<const Vertex> vertices, std::vector<PackedVertex>& packed) {
+    packed.resize(vertices.size());
+
+    if (vertices.empty())
+        return {};
+
+    float lower[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    float upper[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+
+    for (const auto& vertex: vertices) {
+        const float pos[3] = {vertex.pos.x, vertex.pos.y, vertex.pos.z};
+
+        for (int axis = 0; axis < 3; axis++) {
+            lower[axis] = std::min(lower[axis], pos[axis]);
+            upper[axis] = std::max(upper[axis], pos[axis]);
+        }
+    }
+
+    // a flat axis keeps a zero extent, every position on it packs to 0 and decodes to the origin
+    float scale[3];
+    for (int axis = 0; axis < 3; axis++)
+        scale[axis] = upper[axis] > lower[axis] ? 65535.0f / (upper[axis] - lower[axis]) : 0.0f;
+
+    const auto unorm16 = [](float value) { return static_cast<uint16_t>(std::clamp(std::lround(value), 0l, 65535l)); };
+    const auto unorm8 = [](float value) { return static_cast<uint8_t>(std::clamp(std::lround(value * 255.0f), 0l, 255l)); };
+
+    for (size_t index = 0; index < vertices.size(); index++) {
+        const Vertex& vertex = vertices[index];
+        PackedVertex& out = packed[index];
+
+        out.pos[0] = unorm16((vertex.pos.x - lower[0]) * scale[0]);
+        out.pos[1] = unorm16((vertex.pos.y - lower[1]) * scale[1]);
+        out.pos[2] = unorm16((vertex.pos.z - lower[2]) * scale[2]);
+        out.pos[3] = 65535;
+
+        out.color[0] = unorm8(vertex.color.x);
+        out.color[1] = unorm8(vertex.color.y);
+        out.color[2] = unorm8(vertex.color.z);
+        out.color[3] = 255;
+
+        out.texCoord[0] = toHalf(vertex.texCoord.x);
+        out.texCoord[1] = toHalf(vertex.texCoord.y);
+    }
+
+    return {
+        {lower[0], lower[1], lower[2]},
+        {upper[0] - lower[0], upper[1] - lower[1], upper[2] - lower[2]}
+    };
+}
@@ -1,6 +1,9 @@
+#include <chrono>
+#include <filesystem>
 #include <utility>
 
 #include "../include/VulkanApplication.hpp"
+#include "../include/Profiler.hpp"
 
 static
 std::vector<char> readFile(const std::string& fileName) {
@@ -28,6 +31,7 @@ VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT message
 }
 
 void VulkanApplication::initVulkan() {
+    PROFILE_ZONE("initVulkan");
     if (this->verbose)
         std::cout << "Creating vulkan instance" << std::endl;
     this->createInstance();
@@ -48,6 +52,14 @@ void VulkanApplication::initVulkan() {
         std::cout << "Creating a logical device and queue" << std::endl;
     this->createLogicalDevice();
 
+    if (this->verbose)
+        std::cout << "Creating memory allocator" << std::endl;
+    this->allocator.emplace(this->physicalDevice, this->logicalDevice);
+
+    if (this->verbose)
+        std::cout << "Creating staging ring" << std::endl;
+    this->stagingRing.emplace(this->logicalDevice, this->allocator.value(), STAGING_RING_SIZE);
+
     if (this->verbose)
         std::cout << "Creating swap chain" << std::endl;
     this->createSwapChain();
@@ -64,6 +76,10 @@ void VulkanApplication::initVulkan() {
         std::cout << "Creating descriptor set layout" << std::endl;
     this->createDescriptorSetLayout();
 
+    if (this->verbose)
+        std::cout << "Creating pipeline cache" << std::endl;
+    this->createPipelineCache();
+
     if (this->verbose)
         std::cout << "Creating graphics pipeline" << std::endl;
     this->createGraphicsPipeline();
@@ -80,7 +96,38 @@ void VulkanApplication::initVulkan() {
         std::cout << "Creating command pool" << std::endl;
     this->createCommandPool();
 
-    if (texturePath.empty() == false) {
+    if (this->verbose)
+        std::cout << "Creating uniform buffers" << std::endl;
+    this->createUniformBuffers();
+
+    if (this->verbose)
+        std::cout << "Creating descriptor pool" << std::endl;
+    this->createDescriptorPool();
+
+    if (this->verbose)
+        std::cout << "Creating command buffers" << std::endl;
+    this->createCommandBuffer();
+
+    if (this->verbose)
+        std::cout << "Creating sync object" << std::endl;
+    this->createSyncObjects();
+
+    if (this->verbose)
+        std::cout << "Creating timestamp query pools" << std::endl;
+    this->createQueryPools();
+
+    this->swapChainState = true;
+}
+
+void VulkanApplication::loadScene(const MeshCache& mesh, SceneTexture& texture) {
+    PROFILE_ZONE("loadScene");
+    this->mesh = &mesh;
+    this->texture = &texture;
+
+    // the recorded command buffers bind the buffers and descriptor sets of the previous scene
+    this->commandGeneration++;
+
+    if (texture.path.empty() == false) {
         if (this->verbose)
             std::cout << "Creating texture image" << std::endl;
         this->createTextureImage();
@@ -96,10 +143,6 @@ void VulkanApplication::initVulkan() {
         this->createDummyTexture();
     }
 
-    if (this->verbose)
-        std::cout << "Loading model into the vulkan application" << std::endl;
-    this->loadModel();
-
     if (this->verbose)
         std::cout << "Creating vertex buffer" << std::endl;
     this->createVertexBuffer();
@@ -108,30 +151,21 @@ void VulkanApplication::initVulkan() {
         std::cout << "Creating index buffer" << std::endl;
     this->createIndexBuffer();
 
+    // the texture and the mesh go to the GPU in a single submission, nothing waits for it before drawing
     if (this->verbose)
-        std::cout << "Creating uniform buffers" << std::endl;
-    this->createUniformBuffers();
-
-    if (this->verbose)
-        std::cout << "Creating descriptor pool" << std::endl;
-    this->createDescriptorPool();
+        std::cout << "Submitting uploads" << std::endl;
+    this->submitUploads();
 
     if (this->verbose)
         std::cout << "Creating descriptor sets" << std::endl;
     this->createDescriptorSets();
 
     if (this->verbose)
-        std::cout << "Creating command buffers" << std::endl;
-    this->createCommandBuffer();
-
-    if (this->verbose)
-        std::cout << "Creating sync object" << std::endl;
-    this->createSyncObjects();
-
-    this->swapChainState = true;
+        std::cout << *this->allocator << std::endl;
 }
 
 void VulkanApplication::createInstance() {
+    PROFILE_ZONE("createInstance");
     if (this->verbose && !checkValidationLayerSupport()) {
         throw std::runtime_error("validation layers requested, but not available!");
     }
@@ -150,9 +184,13 @@ void VulkanApplication::createInstance() {
 
     //FOR ---- ---- YOU NEED TO ENABLE THE TWO MF BELOW
     
-    auto sfmlExtensions = sf::Vulkan::getGraphicsRequiredInstanceExtensions();
+    std::vector<const char*> extensions;
+
+    if (this->window != nullptr) {
+        auto sfmlExtensions = sf::Vulkan::getGraphicsRequiredInstanceExtensions();
+        extensions.assign(sfmlExtensions.begin(), sfmlExtensions.end());
+    }
 
-    std::vector<const char*> extensions(sfmlExtensions.begin(), sfmlExtensions.end());
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME); // Adds "VK_EXT_debug_utils"
 
     createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
@@ -226,6 +264,7 @@ void VulkanApplication::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCr
 }
 
 void VulkanApplication::setupDebugMessenger() {
+    PROFILE_ZONE("setupDebugMessenger");
     if (this->verbose == false)
         return;
 
@@ -238,11 +277,17 @@ void VulkanApplication::setupDebugMessenger() {
 }
 
 void VulkanApplication::createSurface() {
-    if (this->window.createVulkanSurface(this->instance, this->surface) == false)
+    PROFILE_ZONE("createSurface");
+    // offscreen rendering needs no surface, nor the swap chain extension
+    if (this->window == nullptr)
+        return;
+
+    if (this->window->createVulkanSurface(this->instance, this->surface) == false)
         std::cout << "Failed to create surface" << std::endl;
 }
 
 void VulkanApplication::pickPhysicalDevice() {
+    PROFILE_ZONE("pickPhysicalDevice");
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(this->instance, &deviceCount, nullptr);
 
@@ -282,6 +327,12 @@ void VulkanApplication::pickPhysicalDevice() {
 bool VulkanApplication::isDeviceUsable(const VkPhysicalDevice &device) const {
     QueueFamilyIndices indices = this->findQueueFamilies(device);
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
+
+    if (this->window == nullptr)
+        return indices.isComplete() && supportedFeatures.samplerAnisotropy;
+
     bool extensionsSupported = checkDeviceExtensionSupport(device);
 
     bool swapChainAdequate = false;
@@ -291,9 +342,6 @@ bool VulkanApplication::isDeviceUsable(const VkPhysicalDevice &device) const {
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
 
-    VkPhysicalDeviceFeatures supportedFeatures;
-    vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
-
     return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
 }
 
@@ -328,8 +376,12 @@ QueueFamilyIndices VulkanApplication::findQueueFamilies(const VkPhysicalDevice&
             indices.graphicsFamily = i;
         }
 
+        // offscreen frames are never presented, the graphics family stands in for the present one
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        if (this->window != nullptr)
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        else
+            presentSupport = indices.graphicsFamily.has_value();
 
         if (presentSupport) {
             indices.presentFamily = i;
@@ -342,6 +394,20 @@ QueueFamilyIndices VulkanApplication::findQueueFamilies(const VkPhysicalDevice&
         i++;
     }
 
+    // prefer a transfer only family over one that can also compute
+    for (uint32_t family = 0; family < queueFamilyCount; family++) {
+        const VkQueueFlags flags = queueFamilies[family].queueFlags;
+
+        if ((flags & VK_QUEUE_TRANSFER_BIT) == 0 || (flags & VK_QUEUE_GRAPHICS_BIT) != 0)
+            continue;
+
+        if (indices.transferFamily.has_value() == false || (flags & VK_QUEUE_COMPUTE_BIT) == 0)
+            indices.transferFamily = family;
+
+        if ((flags & VK_QUEUE_COMPUTE_BIT) == 0)
+            break;
+    }
+
     return indices;
 }
 
@@ -397,8 +463,8 @@ VkExtent2D VulkanApplication::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& c
         return capabilities.currentExtent;
     }
 
-    const unsigned int width = window.getSize().x;
-    const unsigned int height = window.getSize().y;
+    const unsigned int width = window->getSize().x;
+    const unsigned int height = window->getSize().y;
 
     VkExtent2D actualExtent = {static_cast<uint32_t>(width),static_cast<uint32_t>(height)};
 
@@ -409,10 +475,14 @@ VkExtent2D VulkanApplication::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& c
 }
 
 void VulkanApplication::createLogicalDevice() {
+    PROFILE_ZONE("createLogicalDevice");
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    this->graphicsFamily = indices.graphicsFamily.value();
+    this->transferFamily = indices.transferFamily.value_or(this->graphicsFamily);
+
+    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value(), this->transferFamily};
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -424,15 +494,21 @@ void VulkanApplication::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(this->physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+    this->textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+    createInfo.enabledExtensionCount = this->window != nullptr ? static_cast<uint32_t>(deviceExtensions.size()) : 0;
     createInfo.ppEnabledExtensionNames = deviceExtensions.data();
     createInfo.enabledLayerCount = 0;
 
@@ -442,9 +518,27 @@ void VulkanApplication::createLogicalDevice() {
 
     vkGetDeviceQueue(this->logicalDevice, indices.graphicsFamily.value(), 0, &this->graphicsQueue);
     vkGetDeviceQueue(this->logicalDevice, indices.presentFamily.value(), 0, &this->presentQueue);
+    vkGetDeviceQueue(this->logicalDevice, this->transferFamily, 0, &this->transferQueue);
+
+    if (this->verbose) {
+        if (this->hasTransferQueue())
+            std::cout << "Uploading on the dedicated transfer queue family " << this->transferFamily << std::endl;
+        else
+            std::cout << "No dedicated transfer queue, uploading on the graphics queue" << std::endl;
+    }
+}
+
+bool VulkanApplication::hasTransferQueue() const {
+    return this->transferFamily != this->graphicsFamily;
 }
 
 void VulkanApplication::createSwapChain() {
+    PROFILE_ZONE("createSwapChain");
+    if (this->window == nullptr) {
+        this->createOffscreenImages();
+        return;
+    }
+
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -498,10 +592,23 @@ void VulkanApplication::createSwapChain() {
     swapChainExtent = extent;
 }
 
+// Stands in for the swap chain when headless: one color image per frame in flight, so a frame never waits for
+// the previous one to release its image, read back by captureFrame
+void VulkanApplication::createOffscreenImages() {
+    PROFILE_ZONE("createOffscreenImages");
+    this->swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    this->swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+    this->offscreenImagesMemory.resize(MAX_FRAMES_IN_FLIGHT);
+
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        createImage(this->swapChainExtent.width, this->swapChainExtent.height, 1, this->swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, this->swapChainImages[i], this->offscreenImagesMemory[i]);
+}
+
 void VulkanApplication::recreateSwapChain() {
-    auto size = window.getSize();
+    PROFILE_ZONE("recreateSwapChain");
+    auto size = window->getSize();
     while (size.x == 0 || size.y == 0) {
-        size = window.getSize();
+        size = window->getSize();
     }
 
     this->wait();
@@ -513,18 +620,23 @@ void VulkanApplication::recreateSwapChain() {
     this->createDepthResources();
     this->createFrameBuffers();
 
+    if (this->prerecorded)
+        this->createRecordedCommandBuffers();
+
     this->swapChainState = true;
 }
 
 void VulkanApplication::createImageViews() {
+    PROFILE_ZONE("createImageViews");
     swapChainImageViews.resize(swapChainImages.size());
 
     for (uint32_t i = 0; i < swapChainImages.size(); i++) {
-        swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+        swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
     }
 }
 
 void VulkanApplication::createRenderPass() {
+    PROFILE_ZONE("createRenderPass");
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = this->swapChainImageFormat;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -533,7 +645,7 @@ void VulkanApplication::createRenderPass() {
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = this->window != nullptr ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 
     VkAttachmentDescription depthAttachment{};
     depthAttachment.format = findDepthFormat();
@@ -583,6 +695,7 @@ void VulkanApplication::createRenderPass() {
 }
 
 void VulkanApplication::createDescriptorSetLayout() {
+    PROFILE_ZONE("createDescriptorSetLayout");
     VkDescriptorSetLayoutBinding uboLayoutBinding{};
     uboLayoutBinding.binding = 0;
     uboLayoutBinding.descriptorCount = 1;
@@ -609,6 +722,7 @@ void VulkanApplication::createDescriptorSetLayout() {
 }
 
 void VulkanApplication::createGraphicsPipeline() {
+    PROFILE_ZONE("createGraphicsPipeline");
     auto vertShaderCode = readFile("shader/vert.spv");
     auto fragShaderCode = readFile("shader/frag.spv");
 
@@ -621,6 +735,21 @@ void VulkanApplication::createGraphicsPipeline() {
     vertShaderStageInfo.module = vertShaderModule;
     vertShaderStageInfo.pName = "main";
 
+    const VkBool32 pushTransformConstant = this->pushTransform ? VK_TRUE : VK_FALSE;
+
+    VkSpecializationMapEntry specializationEntry{};
+    specializationEntry.constantID = 0;
+    specializationEntry.offset = 0;
+    specializationEntry.size = sizeof(pushTransformConstant);
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(pushTransformConstant);
+    specializationInfo.pData = &pushTransformConstant;
+
+    vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
     VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
     fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -632,8 +761,8 @@ void VulkanApplication::createGraphicsPipeline() {
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    auto bindingDescription = this->packed ? PackedVertex::getBindingDescription() : Vertex::getBindingDescription();
+    auto attributeDescriptions = this->packed ? PackedVertex::getAttributeDescriptions() : Vertex::getAttributeDescriptions();
 
     vertexInputInfo.vertexBindingDescriptionCount = 1;
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -700,6 +829,18 @@ void VulkanApplication::createGraphicsPipeline() {
     pipelineLayoutInfo.setLayoutCount = 1;
     pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
 
+    // the transform, when pushed, then the shading mode: switching it only changes what the next frames push
+    std::array<VkPushConstantRange, 2> pushConstantRanges{};
+    pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRanges[0].offset = 0;
+    pushConstantRanges[0].size = sizeof(TransformConstants);
+    pushConstantRanges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRanges[1].offset = sizeof(TransformConstants);
+    pushConstantRanges[1].size = sizeof(ShadingConstants);
+
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
     if (vkCreatePipelineLayout(this->logicalDevice, &pipelineLayoutInfo, nullptr, &this->pipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create pipeline layout!");
     }
@@ -721,14 +862,103 @@ void VulkanApplication::createGraphicsPipeline() {
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(this->logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &this->graphicsPipeline) != VK_SUCCESS) {
+    const auto start = std::chrono::steady_clock::now();
+
+    if (vkCreateGraphicsPipelines(this->logicalDevice, this->pipelineCache, 1, &pipelineInfo, nullptr, &this->graphicsPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 
+    if (this->verbose) {
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Graphics pipeline created in " << elapsed.count() << " ms with a " << (this->pipelineCacheWarm ? "warm" : "cold") << " pipeline cache" << std::endl;
+    }
+
     vkDestroyShaderModule(this->logicalDevice, fragShaderModule, nullptr);
     vkDestroyShaderModule(this->logicalDevice, vertShaderModule, nullptr);
 }
 
+// Seeds the pipeline cache with the data saved by the previous run, when it was written by the same device and
+// driver. The driver would reject anything else on its own, checking the header here tells why it was not used
+void VulkanApplication::createPipelineCache() {
+    PROFILE_ZONE("createPipelineCache");
+    std::vector<char> data;
+
+    if (this->cache) {
+        try {
+            data = readFile(PIPELINE_CACHE_PATH);
+        } catch (std::exception &error) {
+            if (this->verbose)
+                std::cout << "Pipeline cache not used: " << error.what() << std::endl;
+        }
+    }
+
+    if (data.empty() == false) {
+        PipelineCacheHeader header{};
+        const char* reason = nullptr;
+
+        if (data.size() >= sizeof(header))
+            memcpy(&header, data.data(), sizeof(header));
+
+        if (data.size() < sizeof(header) || header.headerSize < sizeof(header) || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+            reason = "unknown format";
+        else if (header.vendorID != this->physicalDeviceProperties.vendorID || header.deviceID != this->physicalDeviceProperties.deviceID)
+            reason = "written for another device";
+        else if (memcmp(header.pipelineCacheUUID, this->physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+            reason = "written by another driver";
+
+        if (reason != nullptr) {
+            if (this->verbose)
+                std::cout << "Pipeline cache not used: " << reason << std::endl;
+            data.clear();
+        }
+    }
+
+    this->pipelineCacheWarm = data.empty() == false;
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.data();
+
+    if (vkCreatePipelineCache(this->logicalDevice, &cacheInfo, nullptr, &this->pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+}
+
+// Writes the pipeline cache back for the next run, through a temporary file renamed over the old one. Called from
+// cleanUp, so failures are reported rather than thrown
+void VulkanApplication::savePipelineCache() {
+    PROFILE_ZONE("savePipelineCache");
+    size_t size = 0;
+
+    if (vkGetPipelineCacheData(this->logicalDevice, this->pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0)
+        return;
+
+    std::vector<char> data(size);
+
+    if (vkGetPipelineCacheData(this->logicalDevice, this->pipelineCache, &size, data.data()) != VK_SUCCESS)
+        return;
+
+    const std::string temporary = std::string(PIPELINE_CACHE_PATH) + ".tmp";
+    std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+
+    output.write(data.data(), static_cast<std::streamsize>(size));
+    output.close();
+
+    std::error_code error;
+
+    if (!output) {
+        std::filesystem::remove(temporary, error);
+        std::cerr << "Failed to write pipeline cache" << std::endl;
+        return;
+    }
+
+    std::filesystem::rename(temporary, PIPELINE_CACHE_PATH, error);
+
+    if (error)
+        std::cerr << "Failed to write pipeline cache: " << error.message() << std::endl;
+}
+
 VkShaderModule VulkanApplication::createShaderModule(const std::vector<char>& code) const {
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -744,6 +974,7 @@ VkShaderModule VulkanApplication::createShaderModule(const std::vector<char>& co
 }
 
 void VulkanApplication::createFrameBuffers() {
+    PROFILE_ZONE("createFrameBuffers");
     this->swapChainFrameBuffers.resize(swapChainImageViews.size());
 
     for (size_t i = 0; i < this->swapChainImageViews.size(); i++) {
@@ -769,6 +1000,7 @@ void VulkanApplication::createFrameBuffers() {
 
 void VulkanApplication::createCommandPool()
 {
+    PROFILE_ZONE("createCommandPool");
     QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
 
     VkCommandPoolCreateInfo poolInfo{};
@@ -779,13 +1011,22 @@ void VulkanApplication::createCommandPool()
     if (vkCreateCommandPool(this->logicalDevice, &poolInfo, nullptr, &this->commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
+
+    // upload command buffers are recorded for the transfer queue, the graphics one when there is none
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = this->transferFamily;
+
+    if (vkCreateCommandPool(this->logicalDevice, &poolInfo, nullptr, &this->transferCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create transfer command pool!");
+    }
 }
 
 void VulkanApplication::createDepthResources() {
+    PROFILE_ZONE("createDepthResources");
     VkFormat depthFormat = findDepthFormat();
 
-    createImage(swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
-    depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+    createImage(swapChainExtent.width, swapChainExtent.height, 1, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+    depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 }
 
 VkFormat VulkanApplication::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
@@ -815,46 +1056,191 @@ bool VulkanApplication::hasStencilComponent(VkFormat format) {
 }
 
 void VulkanApplication::createTextureImage() {
+    PROFILE_ZONE("createTextureImage");
+    if (this->texture->compressed.has_value() && this->createCompressedTextureImage())
+        return;
+
+    // the loading task only decodes the image when no compressed chain was asked for
+    if (this->texture->pixels.empty()) {
+        if (this->verbose)
+            std::cout << "Loading: " << this->texture->path << std::endl;
+        decodeTexture(*this->texture);
+    }
+
+    const uint8_t* pixels = this->texture->pixels.data();
+    const int32_t texWidth = static_cast<int32_t>(this->texture->width);
+    const int32_t texHeight = static_cast<int32_t>(this->texture->height);
+    const VkDeviceSize imageSize = this->texture->pixels.size();
+
+    this->mipLevels = getMipLevels(static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+
+    // the chain is blitted on the GPU when the format can be filtered linearly, built on the CPU otherwise
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
+
+    const bool blit = formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
     if (this->verbose)
-        std::cout << "Loading: " << texturePath << std::endl;
+        std::cout << "Generating " << this->mipLevels << " mip levels on the " << (blit ? "GPU" : "CPU") << std::endl;
 
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load(texturePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
+    createImage(texWidth, texHeight, this->mipLevels, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
 
-    if (!pixels) {
-        throw std::runtime_error("failed to load texture image!");
+    transitionImageLayout(this->textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, this->mipLevels);
+
+    if (blit == false) {
+        const std::vector<MipLevel> levels = getMipChain(static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+
+        const StagingRegion staging = this->stagingRing->allocate(levels.back().offset + levels.back().size);
+        memcpy(staging.data, pixels, static_cast<size_t>(imageSize));
+        buildMipChain(static_cast<uint8_t*>(staging.data), levels);
+
+        for (uint32_t level = 0; level < this->mipLevels; level++)
+            copyBufferToImage(staging.buffer, staging.offset + levels[level].offset, this->textureImage, levels[level].width, levels[level].height, level);
+
+        transitionImageLayout(this->textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, this->mipLevels);
+        return;
+    }
+
+    const StagingRegion staging = this->stagingRing->allocate(imageSize);
+    memcpy(staging.data, pixels, static_cast<size_t>(imageSize));
+
+    copyBufferToImage(staging.buffer, staging.offset, this->textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 0);
+
+    if (this->hasTransferQueue() == false) {
+        generateMipmaps(this->getUploadCommandBuffer(), this->textureImage, texWidth, texHeight, this->mipLevels);
+        return;
     }
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    // blits need a graphics queue, the whole image is released to it in the transfer layout and the next frame
+    // blits the chain right after acquiring it
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = this->transferFamily;
+    barrier.dstQueueFamilyIndex = this->graphicsFamily;
+    barrier.image = this->textureImage;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = this->mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(this->getUploadCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    this->imageAcquires.push_back(barrier);
+    this->pendingMipmaps.push_back({this->textureImage, texWidth, texHeight, this->mipLevels});
+}
+
+// Uploads the block compressed mip chain the loading task mapped or cooked, false when the device cannot sample
+// its format so the RGBA8 path is taken instead
+bool VulkanApplication::createCompressedTextureImage() {
+    const TextureFormat format = this->texture->compressed->getFormat();
+    const VkFormat imageFormat = format == TextureFormat::BC1 ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
+
+    if (this->textureCompressionBC == false || (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0) {
+        if (this->verbose)
+            std::cout << "Block compressed textures are not supported, uploading RGBA8" << std::endl;
+        return false;
+    }
+
+    const TextureCache& chain = this->texture->compressed.value();
+
+    const std::vector<MipLevel>& levels = chain.getLevels();
+    const std::span<const uint8_t> blocks = chain.getData();
+
+    this->textureImageFormat = imageFormat;
+    this->mipLevels = static_cast<uint32_t>(levels.size());
+
+    createImage(chain.getWidth(), chain.getHeight(), this->mipLevels, imageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+
+    transitionImageLayout(this->textureImage, imageFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, this->mipLevels);
+
+    // the blocks are staged as they are laid out in the cache, every level already starts on a 16 byte boundary
+    const StagingRegion staging = this->stagingRing->allocate(blocks.size());
+    memcpy(staging.data, blocks.data(), blocks.size());
+
+    for (uint32_t level = 0; level < this->mipLevels; level++)
+        copyBufferToImage(staging.buffer, staging.offset + levels[level].offset, this->textureImage, levels[level].width, levels[level].height, level);
+
+    transitionImageLayout(this->textureImage, imageFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, this->mipLevels);
+
+    return true;
+}
+
+// Blits every level from the previous one, the image has all its levels in TRANSFER_DST_OPTIMAL and leaves
+// with all of them in SHADER_READ_ONLY_OPTIMAL
+void VulkanApplication::generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, int32_t width, int32_t height, uint32_t mipLevels) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = image;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.subresourceRange.levelCount = 1;
 
-    void* data;
-    vkMapMemory(this->logicalDevice, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(this->logicalDevice, stagingBufferMemory);
+    for (uint32_t level = 1; level < mipLevels; level++) {
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = {0, 0, 0};
+        blit.srcOffsets[1] = {width, height, 1};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.dstOffsets[0] = {0, 0, 0};
+        blit.dstOffsets[1] = {width > 1 ? width / 2 : 1, height > 1 ? height / 2 : 1, 1};
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-    stbi_image_free(pixels);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-    createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+        if (width > 1) width /= 2;
+        if (height > 1) height /= 2;
+    }
 
-    transitionImageLayout(this->textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyBufferToImage(stagingBuffer, this->textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    transitionImageLayout(this->textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-    vkDestroyBuffer(this->logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(this->logicalDevice, stagingBufferMemory, nullptr);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
-void VulkanApplication::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void VulkanApplication::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = format;
     imageInfo.tiling = tiling;
@@ -870,19 +1256,110 @@ void VulkanApplication::createImage(uint32_t width, uint32_t height, VkFormat fo
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(this->logicalDevice, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    imageMemory = this->allocator->allocate(memRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR);
+
+    vkBindImageMemory(this->logicalDevice, image, imageMemory.memory, imageMemory.offset);
+}
+
+VkCommandBuffer VulkanApplication::getUploadCommandBuffer() {
+    this->uploadCommandCount++;
+
+    if (this->uploadCommandBuffer != VK_NULL_HANDLE)
+        return this->uploadCommandBuffer;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = transferCommandPool;
+    allocInfo.commandBufferCount = 1;
 
-    if (vkAllocateMemory(this->logicalDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
+    if (vkAllocateCommandBuffers(this->logicalDevice, &allocInfo, &this->uploadCommandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
     }
 
-    vkBindImageMemory(this->logicalDevice, image, imageMemory, 0);
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(this->uploadCommandBuffer, &beginInfo);
+
+    return this->uploadCommandBuffer;
 }
 
-VkCommandBuffer VulkanApplication::beginSingleTimeCommands() {
+void VulkanApplication::submitUploads() {
+    PROFILE_ZONE("submitUploads");
+    if (this->uploadCommandBuffer != VK_NULL_HANDLE) {
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &this->uploadCommandBuffer;
+
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+
+        if (this->hasTransferQueue()) {
+            // every resource was released to the graphics family as it was copied, the next frame waits for
+            // this semaphore before acquiring them
+            if (this->freeUploadSemaphores.empty()) {
+                VkSemaphoreCreateInfo semaphoreInfo{};
+                semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+                if (vkCreateSemaphore(this->logicalDevice, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create upload semaphore!");
+                }
+            } else {
+                semaphore = this->freeUploadSemaphores.back();
+                this->freeUploadSemaphores.pop_back();
+            }
+
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &semaphore;
+        } else {
+            // the copies are made visible to the vertex input and the shaders of every later submission on the queue,
+            // so drawing does not have to wait for the upload on the CPU
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(this->uploadCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        vkEndCommandBuffer(this->uploadCommandBuffer);
+
+        // the fence also tells the staging ring when the regions read by these commands can be reused
+        if (vkQueueSubmit(transferQueue, 1, &submitInfo, this->stagingRing->submit()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+
+        if (semaphore != VK_NULL_HANDLE)
+            this->uploadSemaphores.push_back(semaphore);
+
+        if (this->verbose)
+            std::cout << "Submitted " << this->uploadCommandCount << " upload commands in one batch" << std::endl;
+
+        this->uploadsInFlight.emplace_back(this->stagingRing->getSubmitted(), this->uploadCommandBuffer);
+        this->uploadCommandBuffer = VK_NULL_HANDLE;
+        this->uploadCommandCount = 0;
+    }
+
+    this->stagingRing->reclaim();
+
+    while (this->uploadsInFlight.empty() == false && this->stagingRing->isComplete(this->uploadsInFlight.front().first)) {
+        vkFreeCommandBuffers(this->logicalDevice, transferCommandPool, 1, &this->uploadsInFlight.front().second);
+        this->uploadsInFlight.pop_front();
+    }
+}
+
+void VulkanApplication::waitUploads() {
+    this->submitUploads();
+    this->stagingRing->wait();
+
+    for (auto& [serial, uploadCommands]: this->uploadsInFlight)
+        vkFreeCommandBuffers(this->logicalDevice, transferCommandPool, 1, &uploadCommands);
+    this->uploadsInFlight.clear();
+}
+
+VkCommandBuffer VulkanApplication::recordAcquires() {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -890,7 +1367,9 @@ VkCommandBuffer VulkanApplication::beginSingleTimeCommands() {
     allocInfo.commandBufferCount = 1;
 
     VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(this->logicalDevice, &allocInfo, &commandBuffer);
+    if (vkAllocateCommandBuffers(this->logicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate acquire command buffer!");
+    }
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -898,25 +1377,42 @@ VkCommandBuffer VulkanApplication::beginSingleTimeCommands() {
 
     vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-    return commandBuffer;
-}
+    if (this->timestamps) {
+        vkCmdResetQueryPool(commandBuffer, this->timestampQueryPools[currentFrame], QUERY_UPLOADS_BEGIN, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, this->timestampQueryPools[currentFrame], QUERY_UPLOADS_BEGIN);
+    }
 
-void VulkanApplication::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-    vkEndCommandBuffer(commandBuffer);
+    // same stages as the semaphore waits, so the acquire (and the image layout change) happen after the upload
+    const VkPipelineStageFlags stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        stages, stages,
+        0,
+        0, nullptr,
+        static_cast<uint32_t>(this->bufferAcquires.size()), this->bufferAcquires.data(),
+        static_cast<uint32_t>(this->imageAcquires.size()), this->imageAcquires.data()
+    );
 
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
+    for (const PendingMipmaps& mipmaps : this->pendingMipmaps)
+        generateMipmaps(commandBuffer, mipmaps.image, mipmaps.width, mipmaps.height, mipmaps.mipLevels);
 
-    vkFreeCommandBuffers(this->logicalDevice, commandPool, 1, &commandBuffer);
+    if (this->timestamps) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, this->timestampQueryPools[currentFrame], QUERY_UPLOADS_END);
+        this->frameUploadsTimestamped[currentFrame] = true;
+    }
+
+    vkEndCommandBuffer(commandBuffer);
+
+    this->bufferAcquires.clear();
+    this->imageAcquires.clear();
+    this->pendingMipmaps.clear();
+
+    return commandBuffer;
 }
 
-void VulkanApplication::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+void VulkanApplication::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
+    VkCommandBuffer commandBuffer = this->getUploadCommandBuffer();
 
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -927,7 +1423,7 @@ void VulkanApplication::transitionImageLayout(VkImage image, VkFormat format, Vk
     barrier.image = image;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
@@ -946,6 +1442,20 @@ void VulkanApplication::transitionImageLayout(VkImage image, VkFormat format, Vk
 
         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+        // a transfer queue cannot reach the fragment shader stage, it releases the image to the graphics family
+        // with the layout change and the next frame acquires it with the same one
+        if (this->hasTransferQueue()) {
+            barrier.srcQueueFamilyIndex = this->transferFamily;
+            barrier.dstQueueFamilyIndex = this->graphicsFamily;
+
+            VkImageMemoryBarrier acquire = barrier;
+            acquire.srcAccessMask = 0;
+            this->imageAcquires.push_back(acquire);
+
+            barrier.dstAccessMask = 0;
+            destinationStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        }
     } else {
         throw std::invalid_argument("unsupported layout transition!");
     }
@@ -958,19 +1468,17 @@ void VulkanApplication::transitionImageLayout(VkImage image, VkFormat format, Vk
         0, nullptr,
         1, &barrier
     );
-
-    endSingleTimeCommands(commandBuffer);
 }
 
-void VulkanApplication::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+void VulkanApplication::copyBufferToImage(VkBuffer buffer, VkDeviceSize offset, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevel) {
+    VkCommandBuffer commandBuffer = this->getUploadCommandBuffer();
 
     VkBufferImageCopy region{};
-    region.bufferOffset = 0;
+    region.bufferOffset = offset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.mipLevel = mipLevel;
     region.imageSubresource.baseArrayLayer = 0;
     region.imageSubresource.layerCount = 1;
     region.imageOffset = {0, 0, 0};
@@ -981,15 +1489,14 @@ void VulkanApplication::copyBufferToImage(VkBuffer buffer, VkImage image, uint32
     };
 
     vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    endSingleTimeCommands(commandBuffer);
 }
 
 void VulkanApplication::createTextureImageView() {
-    textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+    PROFILE_ZONE("createTextureImageView");
+    textureImageView = createImageView(textureImage, this->textureImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, this->mipLevels);
 }
 
-VkImageView VulkanApplication::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
+VkImageView VulkanApplication::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = image;
@@ -997,7 +1504,7 @@ VkImageView VulkanApplication::createImageView(VkImage image, VkFormat format, V
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = aspectFlags;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
@@ -1010,6 +1517,7 @@ VkImageView VulkanApplication::createImageView(VkImage image, VkFormat format, V
 }
 
 void VulkanApplication::createTextureSampler() {
+    PROFILE_ZONE("createTextureSampler");
     VkPhysicalDeviceProperties properties{};
     vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 
@@ -1027,6 +1535,9 @@ void VulkanApplication::createTextureSampler() {
     samplerInfo.compareEnable = VK_FALSE;
     samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
     samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = static_cast<float>(this->mipLevels);
 
     if (vkCreateSampler(this->logicalDevice, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
         throw std::runtime_error("failed to create texture sampler!");
@@ -1034,40 +1545,30 @@ void VulkanApplication::createTextureSampler() {
 }
 
 void VulkanApplication::createDummyTexture() {
+    PROFILE_ZONE("createDummyTexture");
     // 1x1 white pixel RGBA
-    uint8_t whitePixel[4] = {static_cast<uint8_t>(map_Kd[0]), static_cast<uint8_t>(map_Kd[1]), static_cast<uint8_t>(map_Kd[2]), 255};
+    uint8_t whitePixel[4] = {static_cast<uint8_t>(this->texture->color[0]), static_cast<uint8_t>(this->texture->color[1]), static_cast<uint8_t>(this->texture->color[2]), 255};
 
     VkDeviceSize imageSize = sizeof(whitePixel);
 
-    // Create staging buffer
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    // Copy pixel data to staging buffer
-    void* data;
-    vkMapMemory(logicalDevice, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, whitePixel, static_cast<size_t>(imageSize));
-    vkUnmapMemory(logicalDevice, stagingBufferMemory);
+    // Copy pixel data to the staging ring
+    const StagingRegion staging = this->stagingRing->allocate(imageSize);
+    memcpy(staging.data, whitePixel, static_cast<size_t>(imageSize));
 
     // Create dummy image (1x1, VK_FORMAT_R8G8B8A8_UNORM)
-    createImage(1, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, dummyTextureImage, dummyTextureImageMemory);
+    createImage(1, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, dummyTextureImage, dummyTextureImageMemory);
 
     // Transition image layout to DST_OPTIMAL
-    transitionImageLayout(dummyTextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    transitionImageLayout(dummyTextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
 
     // Copy buffer to image
-    copyBufferToImage(stagingBuffer, dummyTextureImage, 1, 1);
+    copyBufferToImage(staging.buffer, staging.offset, dummyTextureImage, 1, 1, 0);
 
     // Transition image layout to SHADER_READ_ONLY_OPTIMAL
-    transitionImageLayout(dummyTextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    // Cleanup staging buffer
-    vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(logicalDevice, stagingBufferMemory, nullptr);
+    transitionImageLayout(dummyTextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
 
     // Create image view for dummy texture
-    dummyTextureImageView = createImageView(dummyTextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+    dummyTextureImageView = createImageView(dummyTextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 
     // Create sampler for dummy texture
     VkSamplerCreateInfo samplerInfo{};
@@ -1093,132 +1594,8 @@ void VulkanApplication::createDummyTexture() {
     }
 }
 
-void VulkanApplication::loadModel() {
-    vertices.clear();
-    indices.clear();
-
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> dis(0.0f, 0.9f);
-
-    for (const auto& shape: obj.getFaces()) {
-
-        const float white = dis(gen);
-
-        const float x = dis(gen);
-        const float y = dis(gen);
-
-        if (this->verbose) {
-            std::cout << "Face color : " << white << std::endl;
-            std::cout << "Face coord : " << x << " " << y << " " << std::endl;
-        }
-
-        if (shape.getVerticesIndex().size() == 3) {
-            for (int index = 0; index < shape.getVerticesIndex().size(); index++) {
-                Vertex vertex{};
-
-                vertex.pos = {
-                    obj.getVertices()[shape.getVerticeIndex(index) - 1].getX(),
-                    obj.getVertices()[shape.getVerticeIndex(index) - 1].getY(),
-                    obj.getVertices()[shape.getVerticeIndex(index) - 1].getZ()
-                };
-
-                if (texturePath.empty() || this->useTexture == false) {
-                    vertex.texCoord.x = x;
-                    vertex.texCoord.y = y;
-                } else {
-                    vertex.texCoord = {obj.getTextureCoordinates()[shape.getTextureIndex(index) - 1].getX(), 1.0f - obj.getTextureCoordinates()[shape.getTextureIndex(index) - 1].getY()};
-                }
-
-                if (this->useTexture == false) {
-                    vertex.color.x = white;
-                    vertex.color.y = white;
-                    vertex.color.z = white;
-                } else {
-                    vertex.color = {1.0f, 1.0f, 1.0f};
-                }
-
-                if (uniqueVertices.count(vertex) == 0) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
-
-                indices.push_back(uniqueVertices[vertex]);
-            }
-        } else if (shape.getVerticesIndex().size() == 4) {
-            int quadIndex[4] = {0, 1, 2, 3};
-
-            for (int i : {0, 1, 2}) {
-                Vertex vertex{};
-
-                vertex.pos = {
-                    obj.getVertices()[shape.getVerticeIndex(quadIndex[i]) - 1].getX(),
-                    obj.getVertices()[shape.getVerticeIndex(quadIndex[i]) - 1].getY(),
-                    obj.getVertices()[shape.getVerticeIndex(quadIndex[i]) - 1].getZ()
-                };
-
-                if (texturePath.empty() || this->useTexture == false) {
-                    vertex.texCoord.x = x;
-                    vertex.texCoord.y = y;
-                } else {
-                    vertex.texCoord = {obj.getTextureCoordinates()[shape.getTextureIndex(quadIndex[i]) - 1].getX(), 1.0f - obj.getTextureCoordinates()[shape.getTextureIndex(quadIndex[i]) - 1].getY()};
-                }
-
-                if (this->useTexture == false) {
-                    vertex.color.x = white;
-                    vertex.color.y = white;
-                    vertex.color.z = white;
-                } else {
-                    vertex.color = {1.0f, 1.0f, 1.0f};
-                }
-
-                if (uniqueVertices.count(vertex) == 0) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
-
-                indices.push_back(uniqueVertices[vertex]);
-            }
-            for (int i : {0, 2, 3}) {
-                Vertex vertex{};
-
-                vertex.pos = {
-                    obj.getVertices()[shape.getVerticeIndex(quadIndex[i]) - 1].getX(),
-                    obj.getVertices()[shape.getVerticeIndex(quadIndex[i]) - 1].getY(),
-                    obj.getVertices()[shape.getVerticeIndex(quadIndex[i]) - 1].getZ()
-                };
-
-                if (texturePath.empty() || this->useTexture == false) {
-                    vertex.texCoord.x = x;
-                    vertex.texCoord.y = y;
-                } else {
-                    vertex.texCoord = {obj.getTextureCoordinates()[shape.getTextureIndex(quadIndex[i]) - 1].getX(), 1.0f - obj.getTextureCoordinates()[shape.getTextureIndex(quadIndex[i]) - 1].getY()};
-                }
-
-                if (this->useTexture == false) {
-                    vertex.color.x = white;
-                    vertex.color.y = white;
-                    vertex.color.z = white;
-                } else {
-                    vertex.color = {1.0f, 1.0f, 1.0f};
-                }
-
-                if (uniqueVertices.count(vertex) == 0) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
-
-                indices.push_back(uniqueVertices[vertex]);
-            }
-        } else {
-            throw std::runtime_error("I'm no dealing with n-gons");
-        }
-    }
-}
-
 void VulkanApplication::createCommandBuffer() {
+    PROFILE_ZONE("createCommandBuffer");
     this->commandBuffer.resize(MAX_FRAMES_IN_FLIGHT);
 
     VkCommandBufferAllocateInfo allocInfo{};
@@ -1230,39 +1607,57 @@ void VulkanApplication::createCommandBuffer() {
     if (vkAllocateCommandBuffers(this->logicalDevice, &allocInfo, this->commandBuffer.data()) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate command buffers!");
     }
+
+    if (this->prerecorded)
+        this->createRecordedCommandBuffers();
 }
 
-void VulkanApplication::createVertexBuffer()  {
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+void VulkanApplication::createRecordedCommandBuffers() {
+    PROFILE_ZONE("createRecordedCommandBuffers");
 
-    if (vertexBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(this->logicalDevice, vertexBuffer, nullptr);
-        vertexBuffer = VK_NULL_HANDLE;
-    }
-    if (vertexBufferMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(this->logicalDevice, vertexBufferMemory, nullptr);
-        vertexBufferMemory = VK_NULL_HANDLE;
+    // the swap chain was recreated, possibly with another image count, after waiting for the device
+    if (this->recordedCommandBuffers.empty() == false)
+        vkFreeCommandBuffers(this->logicalDevice, this->commandPool, static_cast<uint32_t>(this->recordedCommandBuffers.size()), this->recordedCommandBuffers.data());
+
+    this->recordedCommandBuffers.resize(this->swapChainImages.size() * MAX_FRAMES_IN_FLIGHT);
+    // generation 0 is never current, every command buffer is recorded the first time it is used
+    this->recordedGenerations.assign(this->recordedCommandBuffers.size(), 0);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = this->commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = static_cast<uint32_t>(this->recordedCommandBuffers.size());
+
+    if (vkAllocateCommandBuffers(this->logicalDevice, &allocInfo, this->recordedCommandBuffers.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate recorded command buffers!");
     }
+}
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+void VulkanApplication::createVertexBuffer()  {
+    PROFILE_ZONE("createVertexBuffer");
+    const std::span<const Vertex> vertices = this->mesh->getVertices();
+    const void* source = vertices.data();
+    VkDeviceSize bufferSize = vertices.size_bytes();
 
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    if (this->packed) {
+        this->vertexBounds = packVertices(vertices, this->packedVertices);
+        source = this->packedVertices.data();
+        bufferSize = this->packedVertices.size() * sizeof(PackedVertex);
 
-    void* data;
-    vkMapMemory(this->logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, vertices.data(), bufferSize);
-    vkUnmapMemory(this->logicalDevice, stagingBufferMemory);
+        if (this->verbose)
+            std::cout << "Packed " << vertices.size() << " vertices from " << vertices.size_bytes() << " to " << bufferSize << " bytes" << std::endl;
+    }
 
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+    const StagingRegion staging = this->stagingRing->allocate(bufferSize);
+    memcpy(staging.data, source, bufferSize);
 
-    copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
 
-    vkDestroyBuffer(this->logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(this->logicalDevice, stagingBufferMemory, nullptr);
+    copyBuffer(staging.buffer, staging.offset, vertexBuffer, bufferSize);
 }
 
-void VulkanApplication::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+void VulkanApplication::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferMemory) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
@@ -1276,61 +1671,28 @@ void VulkanApplication::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(this->logicalDevice, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    bufferMemory = this->allocator->allocate(memRequirements, properties, true);
 
-    if (vkAllocateMemory(this->logicalDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate buffer memory!");
-    }
-
-    vkBindBufferMemory(this->logicalDevice, buffer, bufferMemory, 0);
-}
-
-uint32_t VulkanApplication::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memoryProperties;
-    vkGetPhysicalDeviceMemoryProperties(this->physicalDevice, &memoryProperties);
-
-    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-        if (typeFilter & 1 << i && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("failed to find suitable memory type!");
+    vkBindBufferMemory(this->logicalDevice, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
 void VulkanApplication::createIndexBuffer() {
-    VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-    if (indexBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(this->logicalDevice, indexBuffer, nullptr);
-        indexBuffer = VK_NULL_HANDLE;
-    }
-    if (indexBufferMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(this->logicalDevice, indexBufferMemory, nullptr);
-        indexBufferMemory = VK_NULL_HANDLE;
-    }
+    PROFILE_ZONE("createIndexBuffer");
+    const std::span<const uint16_t> indices = this->mesh->getIndices();
+    VkDeviceSize bufferSize = indices.size_bytes();
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    this->subMeshes = this->mesh->getSubMeshes();
 
-    void* data;
-    vkMapMemory(this->logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, indices.data(), (size_t) bufferSize);
-    vkUnmapMemory(this->logicalDevice, stagingBufferMemory);
+    const StagingRegion staging = this->stagingRing->allocate(bufferSize);
+    memcpy(staging.data, indices.data(), (size_t) bufferSize);
 
     createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
 
-    copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-
-    vkDestroyBuffer(this->logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(this->logicalDevice, stagingBufferMemory, nullptr);
+    copyBuffer(staging.buffer, staging.offset, indexBuffer, bufferSize);
 }
 
 void VulkanApplication::createUniformBuffers() {
+    PROFILE_ZONE("createUniformBuffers");
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
     this->uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
@@ -1340,11 +1702,12 @@ void VulkanApplication::createUniformBuffers() {
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, this->uniformBuffers[i], this->uniformBuffersMemory[i]);
 
-        vkMapMemory(this->logicalDevice, this->uniformBuffersMemory[i], 0, bufferSize, 0, &this->uniformBuffersMapped[i]);
+        this->uniformBuffersMapped[i] = this->uniformBuffersMemory[i].mapped;
     }
 }
 
 void VulkanApplication::createDescriptorPool() {
+    PROFILE_ZONE("createDescriptorPool");
     std::array<VkDescriptorPoolSize, 2> poolSizes{};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
@@ -1363,6 +1726,7 @@ void VulkanApplication::createDescriptorPool() {
 }
 
 void VulkanApplication::createDescriptorSets() {
+    PROFILE_ZONE("createDescriptorSets");
     std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -1384,7 +1748,7 @@ void VulkanApplication::createDescriptorSets() {
         VkDescriptorImageInfo imageInfo{};
         imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-        if (!texturePath.empty()) {
+        if (!this->texture->path.empty()) {
             imageInfo.imageView = textureImageView;
             imageInfo.sampler = textureSampler;
         } else {
@@ -1414,17 +1778,35 @@ void VulkanApplication::createDescriptorSets() {
     }
 }
 
-void VulkanApplication::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+void VulkanApplication::copyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize size) {
+    VkCommandBuffer commandBuffer = this->getUploadCommandBuffer();
 
     VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = srcOffset;
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-    endSingleTimeCommands(commandBuffer);
+    if (this->hasTransferQueue()) {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = this->transferFamily;
+        barrier.dstQueueFamilyIndex = this->graphicsFamily;
+        barrier.buffer = dstBuffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        this->bufferAcquires.push_back(barrier);
+    }
 }
 
 void VulkanApplication::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    PROFILE_ZONE("recordCommandBuffer");
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -1432,6 +1814,11 @@ void VulkanApplication::recordCommandBuffer(VkCommandBuffer commandBuffer, uint3
         throw std::runtime_error("failed to begin recording command buffer!");
     }
 
+    if (this->timestamps) {
+        vkCmdResetQueryPool(commandBuffer, this->timestampQueryPools[currentFrame], QUERY_RENDER_PASS_BEGIN, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, this->timestampQueryPools[currentFrame], QUERY_RENDER_PASS_BEGIN);
+    }
+
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = renderPass;
@@ -1468,23 +1855,36 @@ void VulkanApplication::recordCommandBuffer(VkCommandBuffer commandBuffer, uint3
     VkDeviceSize offsets[] = {0};
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
 
-    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
 
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
 
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+    const ShadingConstants shading = {this->useTexture ? 1u : 0u};
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(TransformConstants), sizeof(shading), &shading);
+
+    if (this->pushTransform)
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(this->transform), &this->transform);
+
+    for (const SubMesh& subMesh : this->subMeshes)
+        vkCmdDrawIndexed(commandBuffer, subMesh.indexCount, this->instances, subMesh.firstIndex, subMesh.vertexOffset, 0);
 
     vkCmdEndRenderPass(commandBuffer);
 
+    if (this->timestamps)
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, this->timestampQueryPools[currentFrame], QUERY_RENDER_PASS_END);
+
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!");
     }
 }
 
 void VulkanApplication::createSyncObjects() {
+    PROFILE_ZONE("createSyncObjects");
     this->imageAvailableSemaphore.resize(MAX_FRAMES_IN_FLIGHT);
     this->renderFinishedSemaphore.resize(MAX_FRAMES_IN_FLIGHT);
     this->inFlightFence.resize(MAX_FRAMES_IN_FLIGHT);
+    this->frameUploadSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    this->frameAcquireCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -1509,13 +1909,79 @@ void VulkanApplication::createSyncObjects() {
     }
 }
 
+void VulkanApplication::createQueryPools() {
+    PROFILE_ZONE("createQueryPools");
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(this->physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(this->physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    const uint32_t validBits = queueFamilies[this->graphicsFamily].timestampValidBits;
+
+    this->frameTimestamped.assign(MAX_FRAMES_IN_FLIGHT, false);
+    this->frameUploadsTimestamped.assign(MAX_FRAMES_IN_FLIGHT, false);
+
+    // the frame stats fall back to the CPU side timings
+    if (validBits == 0 || this->physicalDeviceProperties.limits.timestampPeriod == 0.0f) {
+        if (this->verbose)
+            std::cout << "Graphics queue has no timestamp support, frame stats are CPU only" << std::endl;
+        return;
+    }
+
+    this->timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t{1} << validBits) - 1;
+    this->timestampQueryPools.resize(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = QUERY_COUNT;
+
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (vkCreateQueryPool(this->logicalDevice, &queryPoolInfo, nullptr, &this->timestampQueryPools[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
+    this->timestamps = true;
+}
+
+void VulkanApplication::readTimestamps() {
+    if (this->timestamps == false || this->frameTimestamped[currentFrame] == false)
+        return;
+
+    // the fence of this frame signaled, every query it wrote is available and nothing waits here
+    const auto elapsed = [this](const uint64_t (&results)[QUERY_COUNT], FrameQuery begin, FrameQuery end) {
+        const uint64_t ticks = (results[end] - results[begin]) & this->timestampMask;
+        return static_cast<double>(ticks) * this->physicalDeviceProperties.limits.timestampPeriod / 1e6;
+    };
+
+    uint64_t results[QUERY_COUNT] = {};
+    const FrameQuery first = this->frameUploadsTimestamped[currentFrame] ? QUERY_UPLOADS_BEGIN : QUERY_RENDER_PASS_BEGIN;
+
+    if (vkGetQueryPoolResults(this->logicalDevice, this->timestampQueryPools[currentFrame], first, QUERY_COUNT - first,
+            sizeof(uint64_t) * (QUERY_COUNT - first), &results[first], sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+        this->frameStats.add(FrameStats::GPU_RENDER_PASS, elapsed(results, QUERY_RENDER_PASS_BEGIN, QUERY_RENDER_PASS_END));
+
+        if (first == QUERY_UPLOADS_BEGIN)
+            this->frameStats.add(FrameStats::GPU_UPLOADS, elapsed(results, QUERY_UPLOADS_BEGIN, QUERY_UPLOADS_END));
+    }
+
+    this->frameTimestamped[currentFrame] = false;
+    this->frameUploadsTimestamped[currentFrame] = false;
+}
+
 void VulkanApplication::cleanUp() {
+    if (this->verbose)
+        std::cout << "Waiting for uploads" << std::endl;
+    this->waitUploads();
+
     if (this->swapChainState) {
         if (this->verbose)
             std::cout << "Destroying image and image view" << std::endl;
         vkDestroyImageView(this->logicalDevice, this->depthImageView, nullptr);
         vkDestroyImage(this->logicalDevice, this->depthImage, nullptr);
-        vkFreeMemory(this->logicalDevice, this->depthImageMemory, nullptr);
+        this->allocator->free(this->depthImageMemory);
 
         if (this->verbose)
             std::cout << "Destroying swap chain frame buffer" << std::endl;
@@ -1529,9 +1995,16 @@ void VulkanApplication::cleanUp() {
             vkDestroyImageView(this->logicalDevice, imageView, nullptr);
         }
 
+        // the swap chain and surface functions come from extensions a headless instance and device do not enable
         if (this->verbose)
             std::cout << "Destroying swap chain" << std::endl;
-        vkDestroySwapchainKHR(this->logicalDevice, this->swapChain, nullptr);
+        if (this->swapChain != VK_NULL_HANDLE)
+            vkDestroySwapchainKHR(this->logicalDevice, this->swapChain, nullptr);
+
+        for (size_t i = 0; i < this->offscreenImagesMemory.size(); i++) {
+            vkDestroyImage(this->logicalDevice, this->swapChainImages[i], nullptr);
+            this->allocator->free(this->offscreenImagesMemory[i]);
+        }
     } else if (this->verbose) {
         std::cout << "Destroying image and image view" << std::endl;
         std::cout << "Destroying swap chain frame buffer" << std::endl;
@@ -1544,16 +2017,28 @@ void VulkanApplication::cleanUp() {
     vkDestroySampler(this->logicalDevice, this->textureSampler, nullptr);
     vkDestroyImageView(this->logicalDevice, this->textureImageView, nullptr);
     vkDestroyImage(this->logicalDevice, this->textureImage, nullptr);
-    vkFreeMemory(this->logicalDevice, this->textureImageMemory, nullptr);
+    this->allocator->free(this->textureImageMemory);
     vkDestroySampler(this->logicalDevice, this->dummyTextureSampler, nullptr);
     vkDestroyImageView(this->logicalDevice, this->dummyTextureImageView, nullptr);
     vkDestroyImage(this->logicalDevice, this->dummyTextureImage, nullptr);
-    vkFreeMemory(this->logicalDevice, this->dummyTextureImageMemory, nullptr);
+    this->allocator->free(this->dummyTextureImageMemory);
 
     if (this->verbose)
         std::cout << "Destroying graphics pipeline" << std::endl;
     vkDestroyPipeline(this->logicalDevice, this->graphicsPipeline, nullptr);
 
+    if (this->pipelineCache != VK_NULL_HANDLE) {
+        if (this->cache) {
+            if (this->verbose)
+                std::cout << "Saving pipeline cache" << std::endl;
+            this->savePipelineCache();
+        }
+
+        if (this->verbose)
+            std::cout << "Destroying pipeline cache" << std::endl;
+        vkDestroyPipelineCache(this->logicalDevice, this->pipelineCache, nullptr);
+    }
+
     if (this->verbose)
         std::cout << "Destroying pipeline layout" << std::endl;
     vkDestroyPipelineLayout(this->logicalDevice, this->pipelineLayout, nullptr);
@@ -1566,7 +2051,7 @@ void VulkanApplication::cleanUp() {
         std::cout << "Destroying uniform buffers" << std::endl;
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroyBuffer(this->logicalDevice, this->uniformBuffers[i], nullptr);
-        vkFreeMemory(this->logicalDevice, this->uniformBuffersMemory[i], nullptr);
+        this->allocator->free(this->uniformBuffersMemory[i]);
     }
 
     if (this->verbose)
@@ -1580,12 +2065,12 @@ void VulkanApplication::cleanUp() {
     if (this->verbose)
         std::cout << "Destroying index buffer" << std::endl;
     vkDestroyBuffer(this->logicalDevice, this->indexBuffer, nullptr);
-    vkFreeMemory(this->logicalDevice, this->indexBufferMemory, nullptr);
+    this->allocator->free(this->indexBufferMemory);
 
     if (this->verbose)
         std::cout << "Destroying vertex buffer" << std::endl;
     vkDestroyBuffer(this->logicalDevice, this->vertexBuffer, nullptr);
-    vkFreeMemory(this->logicalDevice, this->vertexBufferMemory, nullptr);
+    this->allocator->free(this->vertexBufferMemory);
 
     if (this->verbose)
         std::cout << "Destroying sync object" << std::endl;
@@ -1596,9 +2081,33 @@ void VulkanApplication::cleanUp() {
     for (auto in_flight_fence : this->inFlightFence)
         vkDestroyFence(this->logicalDevice, in_flight_fence, nullptr);
 
+    for (auto upload_semaphore : this->uploadSemaphores)
+        vkDestroySemaphore(this->logicalDevice, upload_semaphore, nullptr);
+    for (auto upload_semaphore : this->freeUploadSemaphores)
+        vkDestroySemaphore(this->logicalDevice, upload_semaphore, nullptr);
+    for (const auto& frame_semaphores : this->frameUploadSemaphores)
+        for (auto upload_semaphore : frame_semaphores)
+            vkDestroySemaphore(this->logicalDevice, upload_semaphore, nullptr);
+
+    if (this->verbose)
+        std::cout << "Destroying timestamp query pools" << std::endl;
+    for (auto query_pool : this->timestampQueryPools)
+        vkDestroyQueryPool(this->logicalDevice, query_pool, nullptr);
+
     if (this->verbose)
         std::cout << "Destroying command pool" << std::endl;
     vkDestroyCommandPool(this->logicalDevice, this->commandPool, nullptr);
+    vkDestroyCommandPool(this->logicalDevice, this->transferCommandPool, nullptr);
+
+    if (this->verbose)
+        std::cout << "Destroying staging ring" << std::endl;
+    this->stagingRing.reset();
+
+    if (this->verbose) {
+        std::cout << *this->allocator << std::endl;
+        std::cout << "Destroying memory allocator" << std::endl;
+    }
+    this->allocator.reset();
 
     if (this->verbose)
         std::cout << "Destroying logical device" << std::endl;
@@ -1610,7 +2119,8 @@ void VulkanApplication::cleanUp() {
 
     if (this->verbose)
         std::cout << "Destroying surface instance" << std::endl;
-    vkDestroySurfaceKHR(this->instance, this->surface, nullptr);
+    if (this->surface != VK_NULL_HANDLE)
+        vkDestroySurfaceKHR(this->instance, this->surface, nullptr);
 
     if (this->verbose)
         std::cout << "Destroying vulkan instance" << std::endl;
@@ -1621,7 +2131,7 @@ void VulkanApplication::cleanupSwapChain() {
     if (this->swapChainState) {
         vkDestroyImageView(this->logicalDevice, this->depthImageView, nullptr);
         vkDestroyImage(this->logicalDevice, this->depthImage, nullptr);
-        vkFreeMemory(this->logicalDevice, this->depthImageMemory, nullptr);
+        this->allocator->free(this->depthImageMemory);
 
         for (auto framebuffer : this->swapChainFrameBuffers) {
             vkDestroyFramebuffer(this->logicalDevice, framebuffer, nullptr);
@@ -1638,28 +2148,42 @@ void VulkanApplication::cleanupSwapChain() {
 }
 
 void VulkanApplication::updateUniformBuffer(uint32_t currentImage) {
+    PROFILE_ZONE("updateUniformBuffer");
     static auto startTime = std::chrono::high_resolution_clock::now();
 
     auto currentTime = std::chrono::high_resolution_clock::now();
     float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
+    // offscreen frames advance by a fixed step, every run renders the same frames whatever their speed
+    if (this->window == nullptr)
+        time = static_cast<float>(this->frameCount) / 60.0f;
+
     UniformBufferObject ubo{};
     ubo.model = cookie::rotate(cookie::Matrix4D<float>(1.0f), time * 3.14f, cookie::Vector3D<float>(0.0f, 0.0f, 1.0f)) * cookie::translate(cookie::Matrix4D<float>(1.0f), cookie::Vector3D<float>(center_x, center_y, center_z));
 
+    // packed positions are unorm inside the bounding box, decoded before the rotation
+    if (this->packed)
+        ubo.model = cookie::translate(cookie::scale(cookie::Matrix4D<float>(1.0f), this->vertexBounds.extent), this->vertexBounds.origin) * ubo.model;
+
     ubo.view = cookie::lookAt(cookie::Vector3D<float>(zoom, zoom, zoom), cookie::Vector3D<float>(0.0f, 0.0f, 0.0f), cookie::Vector3D<float>(0.0f, 0.0f, 1.0f));
 
     ubo.proj = cookie::perspective(static_cast<float>(3.14 / 4), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 100.0f);
 
     ubo.proj[1][1] *= -1;
 
-    memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+    // cookie matrices multiply the other way around, this is proj * view * model as the vertex shader has it
+    if (this->pushTransform)
+        this->transform.mvp = ubo.model * ubo.view * ubo.proj;
+    else
+        memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
 }
 
-VulkanApplication::VulkanApplication(bool verbose, sf::Window &window, std::string texturePath, const Obj& obj) : window(window), verbose(verbose), texturePath(std::move(texturePath)), obj(obj), zoom(2.0f) {
+VulkanApplication::VulkanApplication(bool verbose, sf::Window &window, bool packed, bool cache, bool prerecorded, bool pushTransform) : window(&window), verbose(verbose), packed(packed), cache(cache), prerecorded(prerecorded), pushTransform(pushTransform), zoom(2.0f) {
     this->initVulkan();
 }
 
-VulkanApplication::VulkanApplication(bool verbose, sf::Window &window, const cookie::Vector3D<float>& Kd, const Obj& obj) : window(window), verbose(verbose), texturePath(""), obj(obj), zoom(2.0f), map_Kd{Kd.x, Kd.y, Kd.z} {
+VulkanApplication::VulkanApplication(bool verbose, VkExtent2D extent, bool packed, bool cache, bool prerecorded, bool pushTransform) : window(nullptr), verbose(verbose), packed(packed), cache(cache), prerecorded(prerecorded), pushTransform(pushTransform), zoom(2.0f) {
+    this->swapChainExtent = extent;
     this->initVulkan();
 }
 
@@ -1668,20 +2192,43 @@ VulkanApplication::~VulkanApplication() {
 }
 
 void VulkanApplication::drawFrame() {
-    vkWaitForFences(this->logicalDevice, 1, &inFlightFence[currentFrame], VK_TRUE, UINT64_MAX);
+    PROFILE_ZONE("drawFrame");
+    using clock = std::chrono::steady_clock;
+    const auto milliseconds = [](clock::time_point begin, clock::time_point end) {
+        return std::chrono::duration<double, std::milli>(end - begin).count();
+    };
+
+    const auto frameStart = clock::now();
+
+    {
+        PROFILE_ZONE("fence wait");
+        vkWaitForFences(this->logicalDevice, 1, &inFlightFence[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    const auto fenceSignaled = clock::now();
 
-    if (updateTexture) {
-        for (int frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++)
-            vkWaitForFences(this->logicalDevice, 1, &inFlightFence[frame], VK_TRUE, UINT64_MAX);
+    this->readTimestamps();
 
-        this->loadModel();
-        this->createVertexBuffer();
-        this->createIndexBuffer();
-        updateTexture = false;
+    // the acquire and the semaphore waits of the last use of this frame are done
+    if (frameAcquireCommandBuffers[currentFrame] != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(this->logicalDevice, commandPool, 1, &frameAcquireCommandBuffers[currentFrame]);
+        frameAcquireCommandBuffers[currentFrame] = VK_NULL_HANDLE;
     }
+    freeUploadSemaphores.insert(freeUploadSemaphores.end(), frameUploadSemaphores[currentFrame].begin(), frameUploadSemaphores[currentFrame].end());
+    frameUploadSemaphores[currentFrame].clear();
 
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(this->logicalDevice, swapChain, UINT64_MAX, imageAvailableSemaphore[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    // offscreen, every frame in flight has its own image and nothing to acquire it from
+    uint32_t imageIndex = currentFrame;
+    VkResult result = VK_SUCCESS;
+
+    const auto acquireStart = clock::now();
+
+    if (this->window != nullptr) {
+        PROFILE_ZONE("acquire");
+        result = vkAcquireNextImageKHR(this->logicalDevice, swapChain, UINT64_MAX, imageAvailableSemaphore[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
+
+    const auto imageAcquired = clock::now();
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         this->recreateSwapChain();
@@ -1694,27 +2241,95 @@ void VulkanApplication::drawFrame() {
 
     this->updateUniformBuffer(currentFrame);
 
-    vkResetCommandBuffer(commandBuffer[currentFrame], /*VkCommandBufferResetFlagBits*/ 0);
-    recordCommandBuffer(commandBuffer[currentFrame], imageIndex);
+    VkCommandBuffer frameCommandBuffer = commandBuffer[currentFrame];
+
+    if (this->prerecorded) {
+        // the shading push constant is recorded with the draws
+        if (this->useTexture != this->recordedUseTexture) {
+            this->recordedUseTexture = this->useTexture;
+            this->commandGeneration++;
+        }
+
+        // last submitted with the fence of this frame, which signaled, so it is not pending anymore
+        const size_t index = static_cast<size_t>(imageIndex) * MAX_FRAMES_IN_FLIGHT + currentFrame;
+        frameCommandBuffer = recordedCommandBuffers[index];
+
+        if (recordedGenerations[index] != commandGeneration) {
+            vkResetCommandBuffer(frameCommandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
+            recordCommandBuffer(frameCommandBuffer, imageIndex);
+            recordedGenerations[index] = commandGeneration;
+        }
+    } else {
+        vkResetCommandBuffer(frameCommandBuffer, /*VkCommandBufferResetFlagBits*/ 0);
+        recordCommandBuffer(frameCommandBuffer, imageIndex);
+    }
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore waitSemaphores[] = {imageAvailableSemaphore[currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
 
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer[currentFrame];
+    if (this->window != nullptr) {
+        waitSemaphores.push_back(imageAvailableSemaphore[currentFrame]);
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
+    std::vector<VkCommandBuffer> commandBuffers;
+
+    // resources uploaded on the transfer queue since the last frame are acquired before drawing, only the
+    // stages reading them wait for the uploads
+    if (bufferAcquires.empty() == false || imageAcquires.empty() == false) {
+        frameAcquireCommandBuffers[currentFrame] = this->recordAcquires();
+        commandBuffers.push_back(frameAcquireCommandBuffers[currentFrame]);
+    }
+    for (auto semaphore : uploadSemaphores) {
+        waitSemaphores.push_back(semaphore);
+        waitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+    frameUploadSemaphores[currentFrame] = std::move(uploadSemaphores);
+    uploadSemaphores.clear();
+
+    commandBuffers.push_back(frameCommandBuffer);
+
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+
+    submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
 
     VkSemaphore signalSemaphores[] = {renderFinishedSemaphore[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = this->window != nullptr ? 1 : 0;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence[currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer!");
+    {
+        PROFILE_ZONE("submit");
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence[currentFrame]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+    }
+
+    this->frameCount++;
+    this->frameTimestamped[currentFrame] = this->timestamps;
+
+    // the rolling averages of the last period are logged from the frame that ends it
+    const auto endFrame = [&] {
+        this->frameStats.add(FrameStats::CPU_FRAME, milliseconds(frameStart, clock::now()));
+        this->frameStats.add(FrameStats::FENCE_WAIT, milliseconds(frameStart, fenceSignaled));
+        this->frameStats.add(FrameStats::ACQUIRE, milliseconds(acquireStart, imageAcquired));
+
+        if (this->frameStats.endFrame()) {
+            if (this->verbose)
+                std::cout << this->frameStats << std::endl;
+            this->frameStats.reset();
+        }
+
+        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    };
+
+    if (this->window == nullptr) {
+        endFrame();
+        return;
     }
 
     VkPresentInfoKHR presentInfo{};
@@ -1729,7 +2344,10 @@ void VulkanApplication::drawFrame() {
 
     presentInfo.pImageIndices = &imageIndex;
 
-    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    {
+        PROFILE_ZONE("present");
+        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || frameBufferResized) {
         this->recreateSwapChain();
@@ -1738,7 +2356,83 @@ void VulkanApplication::drawFrame() {
         throw std::runtime_error("failed to present swap chain image!");
     }
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    endFrame();
+}
+
+void VulkanApplication::captureFrame(std::vector<uint8_t>& pixels) {
+    if (this->window != nullptr || this->frameCount == 0) {
+        throw std::runtime_error("no offscreen frame to capture!");
+    }
+
+    this->wait();
+
+    const VkImage image = this->swapChainImages[(currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+    const VkDeviceSize size = static_cast<VkDeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+
+    VkBuffer buffer;
+    Allocation bufferMemory;
+    createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, bufferMemory);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(this->logicalDevice, &allocInfo, &commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    // the render pass left the image in TRANSFER_SRC_OPTIMAL, its writes still have to be made visible
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {swapChainExtent.width, swapChainExtent.height, 1};
+
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit frame capture!");
+    }
+    vkQueueWaitIdle(graphicsQueue);
+
+    const auto* data = static_cast<const uint8_t*>(bufferMemory.mapped);
+    pixels.assign(data, data + size);
+
+    vkFreeCommandBuffers(this->logicalDevice, commandPool, 1, &commandBuffer);
+    vkDestroyBuffer(this->logicalDevice, buffer, nullptr);
+    this->allocator->free(bufferMemory);
+}
+
+VkExtent2D VulkanApplication::getExtent() const {
+    return this->swapChainExtent;
 }
 
 void VulkanApplication::wait() {
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+// Offline benchmarks run by `Scope <file> --benchmark`, they do not need a vulkan device
+void benchmarkLoader(const std::string& path);
+void benchmarkWeld(const std::string& path);
+void benchmarkTriangulator();
+void benchmarkPacking(const std::string& path);
+void benchmarkMipmaps();
+void benchmarkBlockCompression();
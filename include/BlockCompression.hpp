@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// Block compressed formats a texture can be cooked to, values are stored in the texture cache
+enum class TextureFormat : uint32_t {
+    BC1 = 1,
+    BC7 = 2,
+};
+
+// Bytes of one 4x4 block, 8 for BC1 and 16 for BC7
+size_t getBlockSize(TextureFormat format);
+
+// Bytes of a width x height image once compressed, partial blocks on the edges count as whole ones
+size_t getCompressedSize(TextureFormat format, uint32_t width, uint32_t height);
+
+// Encode the 4x4 RGBA8 texels at `texels`, whose rows are `stride` bytes apart. BC1 keeps the color only
+// (four color mode, alpha is dropped), BC7 uses mode 6: one RGBA subset with 7 bit endpoints, a p-bit each
+// and 4 bit indices. Both fit the endpoints on the principal axis of the block, then refine them once with
+// a least squares fit to the chosen indices.
+void encodeBC1Block(const uint8_t* texels, size_t stride, uint8_t* block);
+void encodeBC7Block(const uint8_t* texels, size_t stride, uint8_t* block);
+
+// Decode what the encoders write back to RGBA8 texels, BC7 only understands mode 6
+void decodeBC1Block(const uint8_t* block, uint8_t* texels, size_t stride);
+void decodeBC7Block(const uint8_t* block, uint8_t* texels, size_t stride);
+
+// Compresses a width x height RGBA8 image into `blocks` (getCompressedSize bytes), one task per row of blocks
+// on `pool`. Partial edge blocks repeat the last row and column of the image.
+void compressImage(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* blocks, ThreadPool& pool);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+// Rolling averages of what a frame spent where, on the CPU in drawFrame and on the GPU between its timestamp
+// queries. Samples pile up for a period, printed under --verbose then dropped for the next one.
+class FrameStats {
+    public:
+        enum Timing {
+            CPU_FRAME,
+            FENCE_WAIT,
+            ACQUIRE,
+            GPU_UPLOADS,
+            GPU_RENDER_PASS,
+            TIMING_COUNT
+        };
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        std::array<double, TIMING_COUNT> totals{};
+        std::array<size_t, TIMING_COUNT> counts{};
+        size_t frames = 0;
+        clock::time_point periodStart;
+        clock::duration period;
+
+    public:
+        explicit FrameStats(clock::duration period = std::chrono::seconds(1));
+
+        void add(Timing timing, double milliseconds);
+        // Counts a frame, true once the period is over and the averages are worth printing
+        bool endFrame();
+        void reset();
+
+        // Average of the samples of the period, 0 without any
+        [[nodiscard]] double getAverage(Timing timing) const;
+        [[nodiscard]] size_t getCount(Timing timing) const;
+        [[nodiscard]] size_t getFrames() const;
+};
+
+std::ostream& operator<<(std::ostream& os, const FrameStats& stats);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// What a cache records of the file it was built from, to tell when it is out of date
+struct FileStamp {
+    uint64_t size;
+    int64_t mtime;
+};
+
+class MappedFile {
+    private:
+        const char* data = nullptr;
+        size_t size = 0;
+
+    public:
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        [[nodiscard]] const char* getData() const;
+        [[nodiscard]] size_t getSize() const;
+        [[nodiscard]] std::string_view getView() const;
+};
+
+// Size and modification time (in nanoseconds) of the file at `path`, throws if it cannot be opened
+FileStamp stampFile(const std::string& path);
+
+// FNV-1a over the whole file, caches only compute it when the size matches but the mtime does not
+uint64_t hashFile(const std::string& path);
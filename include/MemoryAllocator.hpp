@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <set>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// A range of a device memory block handed out by MemoryAllocator, bound with vkBind*Memory(memory, offset)
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // host address of the range when the memory type is host visible, blocks stay mapped while they live
+    void* mapped = nullptr;
+    uint32_t pool = 0;
+    uint32_t block = 0;
+    uint32_t order = 0;
+};
+
+// Sub-allocates buffers and images from large vkAllocateMemory blocks instead of one allocation per resource.
+// Every memory type has two pools, one for buffers (linear) and one for optimal tiling images, so a buffer and
+// an image never share a bufferImageGranularity page. Blocks are buddy heaps: a request is rounded to a power of
+// two (at least its alignment) and split from the smallest free range, freed ranges merge back with their buddy.
+class MemoryAllocator {
+    private:
+        static constexpr VkDeviceSize MIN_SIZE = 256;
+        static constexpr VkDeviceSize BLOCK_SIZE = 64 * 1024 * 1024;
+
+        struct Block {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            void* mapped = nullptr;
+            VkDeviceSize used = 0;
+            VkDeviceSize requested = 0;
+            size_t allocations = 0;
+            // offsets of the free ranges of MIN_SIZE << order, per order
+            std::vector<std::set<VkDeviceSize>> free;
+        };
+
+        VkDevice device;
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
+        std::vector<std::vector<Block>> pools;
+        size_t allocationCount = 0;
+
+        VkDeviceSize getBlockSize(uint32_t memoryType, VkDeviceSize size) const;
+        uint32_t createBlock(uint32_t pool, VkDeviceSize size);
+        void destroyBlock(Block& block);
+        static bool split(Block& block, uint32_t order, VkDeviceSize& offset);
+
+    public:
+        MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+        ~MemoryAllocator();
+
+        MemoryAllocator(const MemoryAllocator&) = delete;
+        MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+        // `linear` is true for buffers and linear tiling images, false for optimal tiling images
+        Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+        // Gives the range back and resets `allocation`, an empty allocation is ignored
+        void free(Allocation& allocation);
+
+        // Index of the first memory type allowed by `typeFilter` with all of `properties`, from the cached properties
+        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+        friend std::ostream& operator<<(std::ostream& os, const MemoryAllocator& allocator);
+};
+
+std::ostream& operator<<(std::ostream& os, const MemoryAllocator& allocator);
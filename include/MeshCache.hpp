@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../include/Obj.hpp"
+#include "../include/Vertex.hpp"
+#include "../include/MappedFile.hpp"
+
+// A range of the index buffer drawn with its own base vertex, so its 16 bit indices can address
+// a mesh of more than 65536 vertices
+struct SubMesh {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+};
+
+// The deduplicated vertex and index arrays handed to the GPU, drawn by both shading modes: every vertex has its
+// uv, and the first (provoking) vertex of every triangle has the random color of its face, read with flat
+// interpolation by the color mode. Either built from a parsed Obj or mmapped from the `<model>.scopecache` file
+// written next to the model, in which case the spans point straight into the mapping and are copied from there
+// into the staging buffers.
+class MeshCache {
+    private:
+        std::optional<MappedFile> file;
+
+        std::vector<Vertex> vertices_storage;
+        std::vector<uint16_t> indices_storage;
+        std::vector<SubMesh> submeshes_storage;
+
+        std::span<const Vertex> vertices;
+        std::span<const uint16_t> indices;
+        std::span<const SubMesh> submeshes;
+        std::vector<std::string> material_path;
+        bool textured = false;
+        bool optimized = false;
+
+        static void buildMesh(const Obj& obj, bool textured, bool verbose, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+        static void splitMesh(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<uint16_t>& local, std::vector<SubMesh>& submeshes);
+
+    public:
+        // Maps the cache of the model at `path`, throws if it is missing, corrupted or older than the model
+        explicit MeshCache(const std::string& path);
+        // Builds the mesh from the parsed model, `textured` uses the model uv instead of random ones,
+        // `optimize` reorders them for the vertex cache (see optimizeMesh)
+        MeshCache(const Obj& obj, bool textured, bool optimize, bool verbose);
+        ~MeshCache();
+
+        MeshCache(const MeshCache&) = delete;
+        MeshCache& operator=(const MeshCache&) = delete;
+
+        // Writes the cache of the model at `path`, through a temporary file renamed over the old cache
+        void save(const std::string& path) const;
+
+        static std::string getCachePath(const std::string& path);
+
+        [[nodiscard]] std::span<const Vertex> getVertices() const;
+        [[nodiscard]] std::span<const uint16_t> getIndices() const;
+        [[nodiscard]] std::span<const SubMesh> getSubMeshes() const;
+        [[nodiscard]] const std::vector<std::string>& getMaterialPath() const;
+        [[nodiscard]] bool hasImage() const;
+        [[nodiscard]] bool isTextured() const;
+        [[nodiscard]] bool isOptimized() const;
+        [[nodiscard]] bool isMapped() const;
+};
+
+std::ostream& operator<<(std::ostream& os, const MeshCache& mesh);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../include/Vertex.hpp"
+
+// Reorders an indexed triangle list for the GPU, the triangles for the post-transform vertex cache
+// (Tipsify, Sander et al. 2007) with its clusters sorted to draw outward facing ones first against
+// overdraw, then the vertices in the order the index buffer fetches them. The mesh is left unchanged
+// apart from the order of its triangles and vertices.
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// Average cache miss ratio, vertex shader invocations per triangle with a FIFO cache of `cache_size`
+// entries: 3 without any reuse, 0.5 at best on a regular grid
+float computeACMR(std::span<const uint32_t> indices, size_t cache_size = 32);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// One level of a mip chain stored level after level in a single RGBA8 buffer
+struct MipLevel {
+    uint32_t width;
+    uint32_t height;
+    size_t offset;
+    size_t size;
+};
+
+// Number of levels down to 1x1, floor(log2(max(width, height))) + 1
+uint32_t getMipLevels(uint32_t width, uint32_t height);
+
+// Layout of the full chain of a width x height RGBA8 image, every level starts on a 16 byte boundary
+std::vector<MipLevel> getMipChain(uint32_t width, uint32_t height);
+
+// Fills every level after the first of `chain` (laid out by getMipChain, level 0 already written) with a
+// 2x2 box filter of the previous one. Color channels are averaged in linear space as they are sRGB encoded,
+// alpha as is. An odd dimension folds its last row or column into the last texel instead of dropping it.
+void buildMipChain(uint8_t* chain, std::span<const MipLevel> levels);
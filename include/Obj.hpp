@@ -3,42 +3,95 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <cstdint>
 #include <iostream>
+#include <span>
+#include <string_view>
 
 #include "../template/Vector.tpp"
 
+enum class ObjLoader {
+    Stream, // getline + istringstream, kept as the reference implementation
+    Mapped, // mmap the file and scan it in place with std::from_chars
+    Parallel // same as Mapped, but the file is split at line boundaries and the chunks parsed on a thread pool
+};
+
+// A view over one face of an Obj, the indices live in the Obj's flat face arrays
 class Face {
     private:
-        std::vector<int> vertices_index;
-        std::vector<int> textures_index;
-        std::vector<int> normals_index;
+        std::span<const int> vertices_index;
+        std::span<const int> textures_index;
+        std::span<const int> normals_index;
 
     public:
-        Face();
+        Face(std::span<const int> vertices, std::span<const int> textures, std::span<const int> normals);
         ~Face();
 
-        [[nodiscard]] const std::vector<int>& getVerticesIndex() const;
-        [[nodiscard]] const std::vector<int>& getTexturesIndex() const;
-        [[nodiscard]] const std::vector<int>& getNormalsIndex() const;
+        [[nodiscard]] std::span<const int> getVerticesIndex() const;
+        [[nodiscard]] std::span<const int> getTexturesIndex() const;
+        [[nodiscard]] std::span<const int> getNormalsIndex() const;
 
         [[nodiscard]] int getVerticeIndex(int index) const;
         [[nodiscard]] int getTextureIndex(int index) const;
         [[nodiscard]] int getNormalIndex(int index) const;
-
-        void addVerticesIndex(int vertices);
-        void addTexturesIndex(int textures);
-        void addNormalsIndex(int normals);
 };
 
 std::ostream& operator<<(std::ostream& os, const Face& face);
 
+// Range of Face views built on the fly from the CSR arrays of an Obj
+class FaceList {
+    private:
+        std::span<const uint32_t> offsets;
+        std::span<const int> vertices_index;
+        std::span<const int> textures_index;
+        std::span<const int> normals_index;
+
+    public:
+        class iterator {
+            private:
+                const FaceList* list = nullptr;
+                size_t index = 0;
+
+            public:
+                using value_type = Face;
+                using difference_type = std::ptrdiff_t;
+
+                iterator() = default;
+                iterator(const FaceList* list, size_t index);
+
+                Face operator*() const;
+                iterator& operator++();
+                iterator operator++(int);
+                bool operator==(const iterator& other) const = default;
+        };
+
+        FaceList(std::span<const uint32_t> offsets, std::span<const int> vertices, std::span<const int> textures, std::span<const int> normals);
+
+        [[nodiscard]] size_t size() const;
+        [[nodiscard]] bool empty() const;
+        [[nodiscard]] Face operator[](size_t index) const;
+        [[nodiscard]] iterator begin() const;
+        [[nodiscard]] iterator end() const;
+};
+
 class Obj {
     private:
+        // a negative index met while parsing a chunk, it is relative to the chunk and needs the global offset
+        struct RelativeIndex {
+            size_t corner;
+            int attribute; // 0 vertex, 1 texture, 2 normal
+        };
+
         std::vector<cookie::Vector3D<float>> vertices = {};
         std::vector<cookie::Vector2D<float>> texture_coordinates = {};
         std::vector<cookie::Vector3D<float>> normals = {};
-        std::vector<Face> faces;
+        // faces are stored CSR style: face n owns the corners [face_offsets[n], face_offsets[n + 1]) of the three index arrays
+        std::vector<uint32_t> face_offsets = {0};
+        std::vector<int> face_vertices;
+        std::vector<int> face_textures;
+        std::vector<int> face_normals;
         std::vector<std::string> material_path;
+        std::vector<RelativeIndex> relative_indices;
 
         void parseVertex(const std::string &line);
         void parseTexCoord(const std::string &line);
@@ -46,14 +99,26 @@ class Obj {
         void parseFace(const std::string &line);
         void parseMaterial(const std::string &line, std::string path_obj);
 
+        void loadStream(const std::string& path);
+        void loadMapped(const std::string& path);
+        void loadParallel(const std::string& path, unsigned int threads);
+        void parseBuffer(std::string_view buffer, const std::string& path);
+
+        Obj() = default;
+
     public:
-        explicit Obj(const std::string& path);
+        // threads is only used by ObjLoader::Parallel, 0 means one per core
+        explicit Obj(const std::string& path, ObjLoader loader = ObjLoader::Mapped, unsigned int threads = 0);
         ~Obj();
 
         [[nodiscard]] const std::vector<cookie::Vector3D<float>>& getVertices() const;
         [[nodiscard]] const std::vector<cookie::Vector2D<float>>& getTextureCoordinates() const;
         [[nodiscard]] const std::vector<cookie::Vector3D<float>>& getNormals() const;
-        [[nodiscard]] const std::vector<Face>& getFaces() const;
+        [[nodiscard]] FaceList getFaces() const;
+        [[nodiscard]] const std::vector<uint32_t>& getFaceOffsets() const;
+        [[nodiscard]] const std::vector<int>& getFaceVerticesIndex() const;
+        [[nodiscard]] const std::vector<int>& getFaceTexturesIndex() const;
+        [[nodiscard]] const std::vector<int>& getFaceNormalsIndex() const;
         [[nodiscard]] const std::vector<std::string>& getMaterialPath() const;
 
         bool hasImage() const;
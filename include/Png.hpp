@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Writes a width x height RGBA8 image as a PNG. The image data is stored without compression (deflate stored
+// blocks), these files are compared against golden images, not shipped, so size does not matter
+void writePng(const std::string& path, const uint8_t* pixels, uint32_t width, uint32_t height);
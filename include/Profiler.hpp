@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scoped CPU zones, recorded per thread while --trace is on and written as Chrome trace events, to be opened in
+// chrome://tracing or ui.perfetto.dev. Built without SCOPE_PROFILER, PROFILE_ZONE expands to nothing.
+class Profiler {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        // the last RING_SIZE zones of a thread are kept, older ones are overwritten
+        static constexpr size_t RING_SIZE = 16384;
+
+        struct Event {
+            // a string literal, only the pointer is kept
+            const char* name;
+            int64_t begin;
+            int64_t end;
+        };
+
+        // Written by its thread alone: an event is stored in its slot before the head moves past it, so
+        // recording never takes a lock. Rings live until the trace is written, after their thread is gone.
+        struct Ring {
+            std::array<Event, RING_SIZE> events;
+            std::atomic<uint64_t> head = 0;
+            uint32_t thread = 0;
+        };
+
+    private:
+        static std::atomic<bool> enabled;
+
+        static Ring& getRing();
+
+    public:
+        // Starts recording, the calling thread shows up first in the trace
+        static void start();
+        // Stops recording and writes every zone kept so far to `path`, once the threads recording are done
+        static void write(const std::string& path);
+
+        static bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        static void record(const char* name, clock::time_point begin, clock::time_point end);
+};
+
+// Records the time from its construction to its destruction under `name`, when the profiler is recording
+class ProfileZone {
+    private:
+        const char* name;
+        Profiler::clock::time_point begin;
+        bool active;
+
+    public:
+        explicit ProfileZone(const char* name) : name(name), active(Profiler::isEnabled()) {
+            if (this->active)
+                this->begin = Profiler::clock::now();
+        }
+
+        ~ProfileZone() {
+            if (this->active)
+                Profiler::record(this->name, this->begin, Profiler::clock::now());
+        }
+
+        ProfileZone(const ProfileZone&) = delete;
+        ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SCOPE_PROFILER
+#define PROFILE_ZONE(name) const ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) static_cast<void>(0)
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../include/TextureCache.hpp"
+
+// The texture of the scene as its loading task leaves it for the renderer: the compressed mip chain (mapped from
+// its cache or cooked) when one was asked for, the decoded RGBA8 image otherwise. Without a texture map (empty
+// path) the scene is drawn with a 1x1 texture of its diffuse color.
+struct SceneTexture {
+    std::string path;
+    std::array<float, 3> color = {255.0f, 255.0f, 255.0f};
+    std::optional<TextureCache> compressed;
+    std::vector<uint8_t> pixels;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// Decodes the image at `texture.path` into its RGBA8 pixels, throws if it cannot be loaded
+void decodeTexture(SceneTexture& texture);
+
+// Prepares the texture at `texture.path` for upload: the chain compressed to `compression`, mapped from its cache
+// or cooked (and saved with `cache`), or the decoded image without compression
+void loadTexture(SceneTexture& texture, std::optional<TextureFormat> compression, bool cache, bool verbose);
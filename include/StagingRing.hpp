@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "../include/MemoryAllocator.hpp"
+
+// Where an upload is written before a copy command moves it to its device local resource
+struct StagingRegion {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    void* data = nullptr;
+};
+
+// Persistently mapped host visible buffer that uploads are written into one after the other. Every submission
+// reading from the ring gets a fence from `submit`, the space written before it is reclaimed once that fence
+// signals. An upload larger than the ring, or made while the ring is filled by unsubmitted uploads, gets its
+// own buffer released the same way.
+class StagingRing {
+    private:
+        struct Submission {
+            uint64_t serial;
+            VkFence fence;
+            VkDeviceSize end;
+            std::vector<std::pair<VkBuffer, Allocation>> overflow;
+        };
+
+        VkDevice device;
+        MemoryAllocator& allocator;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        Allocation memory;
+        VkDeviceSize capacity;
+
+        // written from head, in use by the GPU from tail, head == tail when nothing is in use
+        VkDeviceSize head = 0;
+        VkDeviceSize tail = 0;
+        std::deque<Submission> inFlight;
+        std::vector<std::pair<VkBuffer, Allocation>> pendingOverflow;
+        std::vector<VkFence> fences;
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+
+        void createBuffer(VkDeviceSize size, VkBuffer& buffer, Allocation& memory);
+        bool place(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+        void retire();
+
+    public:
+        StagingRing(VkDevice device, MemoryAllocator& allocator, VkDeviceSize capacity);
+        ~StagingRing();
+
+        StagingRing(const StagingRing&) = delete;
+        StagingRing& operator=(const StagingRing&) = delete;
+
+        // Space for `size` bytes, waits for the oldest submissions when the ring is full
+        StagingRegion allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+        // Fence to submit the copies of every region allocated since the previous call with, the fences are
+        // recycled so a submission is followed through its serial (getSubmitted right after) rather than its fence
+        VkFence submit();
+        // Reclaims the space of the signaled submissions without blocking
+        void reclaim();
+        // Waits for every submission and reclaims the whole ring
+        void wait();
+
+        [[nodiscard]] uint64_t getSubmitted() const;
+        // Whether the submission `serial` was seen signaled by the last reclaim, allocate or wait
+        [[nodiscard]] bool isComplete(uint64_t serial) const;
+};
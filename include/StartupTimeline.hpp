@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../include/Profiler.hpp"
+
+// Wall clock spans of the startup tasks, from whichever thread runs them, printed under --verbose to see
+// what overlapped and what the window waited on
+class StartupTimeline {
+    private:
+        using clock = std::chrono::steady_clock;
+
+        struct Span {
+            std::string name;
+            clock::time_point begin;
+            clock::time_point end;
+        };
+
+        clock::time_point origin;
+        std::vector<Span> spans;
+        mutable std::mutex mutex;
+
+    public:
+        StartupTimeline();
+
+        StartupTimeline(const StartupTimeline&) = delete;
+        StartupTimeline& operator=(const StartupTimeline&) = delete;
+
+        void record(const std::string& name, clock::time_point begin, clock::time_point end);
+
+        // Runs `function` and records the time it took under `name`, even when it throws. `name` is a string
+        // literal, it also names the zone of the task in the --trace output
+        template <class Function>
+        auto measure(const char* name, Function&& function) -> std::invoke_result_t<Function>;
+
+        friend std::ostream& operator<<(std::ostream& os, const StartupTimeline& timeline);
+};
+
+template <class Function>
+auto StartupTimeline::measure(const char* name, Function&& function) -> std::invoke_result_t<Function> {
+    PROFILE_ZONE(name);
+
+    struct Recorder {
+        StartupTimeline& timeline;
+        const char* name;
+        clock::time_point begin;
+
+        ~Recorder() {
+            timeline.record(name, begin, clock::now());
+        }
+    } recorder{*this, name, clock::now()};
+
+    return std::forward<Function>(function)();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../include/BlockCompression.hpp"
+#include "../include/MappedFile.hpp"
+#include "../include/Mipmap.hpp"
+
+// The block compressed mip chain of a texture, level after level. Either cooked from the image (mip chain built
+// on the CPU then every level compressed on a thread pool) or mmapped from the `<image>.scopetex` file written
+// next to it, the KTX2 idea without its container: a header with the format, size and level index, then the
+// blocks of every level on a 16 byte boundary, ready to be copied into a staging buffer as they are.
+class TextureCache {
+    private:
+        std::optional<MappedFile> file;
+
+        std::vector<uint8_t> data_storage;
+        std::span<const uint8_t> data;
+        std::vector<MipLevel> levels;
+        TextureFormat format = TextureFormat::BC7;
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+    public:
+        // Maps the cache of the image at `path`, throws if it is missing, corrupted or older than the image
+        explicit TextureCache(const std::string& path);
+        // Loads the image at `path` and compresses its whole mip chain to `format`
+        TextureCache(const std::string& path, TextureFormat format, bool verbose);
+        ~TextureCache();
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        // Writes the cache of the image at `path`, through a temporary file renamed over the old cache
+        void save(const std::string& path) const;
+
+        static std::string getCachePath(const std::string& path);
+
+        [[nodiscard]] TextureFormat getFormat() const;
+        [[nodiscard]] uint32_t getWidth() const;
+        [[nodiscard]] uint32_t getHeight() const;
+        // Size of every level in texels, offset and size of its blocks in getData
+        [[nodiscard]] const std::vector<MipLevel>& getLevels() const;
+        [[nodiscard]] std::span<const uint8_t> getData() const;
+        [[nodiscard]] bool isMapped() const;
+};
+
+std::ostream& operator<<(std::ostream& os, const TextureCache& texture);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+    private:
+        std::vector<std::jthread>               workers;
+        std::deque<std::move_only_function<void()>> tasks;
+        std::mutex                              mutex;
+        std::condition_variable                 condition;
+        bool                                    stopping = false;
+
+        void                                    work();
+
+    public:
+        explicit ThreadPool(unsigned int count = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        [[nodiscard]] size_t                    getSize() const;
+
+        template <class Function>
+        auto                                    submit(Function&& function) -> std::future<std::invoke_result_t<Function>>;
+};
+
+template <class Function>
+auto ThreadPool::submit(Function&& function) -> std::future<std::invoke_result_t<Function>> {
+    std::packaged_task<std::invoke_result_t<Function>()> task(std::forward<Function>(function));
+    auto future = task.get_future();
+
+    {
+        std::lock_guard lock(this->mutex);
+        this->tasks.emplace_back(std::move(task));
+    }
+    this->condition.notify_one();
+
+    return future;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../template/Vector.tpp"
+
+// Splits the polygonal faces of an Obj into triangles. Convex polygons are fanned from their first
+// corner, concave ones are ear clipped after projecting them on their best-fit (Newell) plane.
+// The scratch buffers are kept between calls so a mesh is triangulated without per-polygon allocations.
+class Triangulator {
+    private:
+        std::vector<cookie::Vector3D<float>> points;
+        std::vector<float> u;
+        std::vector<float> v;
+        std::vector<uint32_t> previous;
+        std::vector<uint32_t> next;
+        std::vector<uint32_t> triangles;
+
+        void split(std::span<const cookie::Vector3D<float>> polygon);
+        void clip(size_t count, float orientation);
+        [[nodiscard]] bool isEar(uint32_t corner, float orientation) const;
+
+    public:
+        Triangulator();
+        ~Triangulator();
+
+        // Appends the triangles of the polygon whose corners are `positions[face[i] - 1]` to `indices`,
+        // writing `corners[i]` for corner i
+        void triangulate(std::span<const int> face, const std::vector<cookie::Vector3D<float>>& positions, std::span<const uint32_t> corners, std::vector<uint32_t>& indices);
+
+        // Appends the triangles of a polygon given by its corner positions, as corner numbers
+        void triangulate(std::span<const cookie::Vector3D<float>> polygon, std::vector<uint32_t>& indices);
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "../template/Vector.tpp"
+
+struct Vertex {
+    cookie::Vector3D<float> pos;
+    cookie::Vector3D<float> color;
+    cookie::Vector2D<float> texCoord;
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(Vertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[0].offset = offsetof(Vertex, pos);
+
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(Vertex, color);
+
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+
+        return attributeDescriptions;
+    }
+
+    // The eight components as raw bits, without the alignment padding, to weld vertices in a cookie::WeldTable.
+    // Adding +0.0f turns -0.0f into +0.0f so the two still weld like they compare with operator==
+    std::array<uint32_t, 8> getWeldKey() const {
+        const auto bits = [](float value) { return std::bit_cast<uint32_t>(value + 0.0f); };
+
+        return {
+            bits(pos.x), bits(pos.y), bits(pos.z),
+            bits(color.x), bits(color.y), bits(color.z),
+            bits(texCoord.x), bits(texCoord.y)
+        };
+    }
+
+    bool operator==(const Vertex& other) const {
+        return pos == other.pos && color == other.color && texCoord == other.texCoord;
+    }
+};
+
+// Vertex compressed to 16 bytes instead of 48: position as 16 bit unorm inside the mesh bounding box, color as
+// RGBA8 unorm and uv as half floats (they may tile outside [0, 1]). The vertex input formats decode them to floats
+// before the shader, the position is brought back to model space by the VertexBounds folded in the model matrix.
+struct PackedVertex {
+    uint16_t pos[4];
+    uint8_t color[4];
+    uint16_t texCoord[2];
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(PackedVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(PackedVertex, pos);
+
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+        attributeDescriptions[1].offset = offsetof(PackedVertex, color);
+
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(PackedVertex, texCoord);
+
+        return attributeDescriptions;
+    }
+};
+
+static_assert(sizeof(PackedVertex) == 16);
+
+// Bounding box of a packed mesh, a packed position p decodes to origin + extent * p
+struct VertexBounds {
+    cookie::Vector3D<float> origin;
+    cookie::Vector3D<float> extent;
+};
+
+// Packs `vertices` into `packed` (resized to match) and returns the bounds to decode their positions with
+VertexBounds packVertices(std::span<const Vertex> vertices, std::vector<PackedVertex>& packed);
+
+// Float to IEEE half, rounded to nearest even
+uint16_t toHalf(float value);
+
+inline void hashCombine(std::size_t& seed, std::size_t value) {
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+namespace std {
+    template<>
+    struct hash<Vertex> {
+        size_t operator()(const Vertex& vertex) const noexcept {
+            size_t seed = 0;
+            // Manually hash each float component if cookie::Vector* lacks hashing
+            hashCombine(seed, std::hash<float>()(vertex.pos.x));
+            hashCombine(seed, std::hash<float>()(vertex.pos.y));
+            hashCombine(seed, std::hash<float>()(vertex.pos.z));
+
+            hashCombine(seed, std::hash<float>()(vertex.color.x));
+            hashCombine(seed, std::hash<float>()(vertex.color.y));
+            hashCombine(seed, std::hash<float>()(vertex.color.z));
+
+            hashCombine(seed, std::hash<float>()(vertex.texCoord.x));
+            hashCombine(seed, std::hash<float>()(vertex.texCoord.y));
+
+            return seed;
+        }
+    };
+}
@@ -6,6 +6,7 @@
 #include <optional>
 #include <vector>
 #include <set>
+#include <deque>
 #include <algorithm>
 #include <cstring>
 #include <unordered_map>
@@ -16,92 +17,54 @@
 #include <SFML/Window/Window.hpp>
 #include <SFML/Window/Vulkan.hpp>
 
-#include "../include/Obj.hpp"
+#include "../include/Vertex.hpp"
+#include "../include/MeshCache.hpp"
+#include "../include/MemoryAllocator.hpp"
+#include "../include/StagingRing.hpp"
+#include "../include/Mipmap.hpp"
+#include "../include/SceneTexture.hpp"
+#include "../include/FrameStats.hpp"
 #include "../include/stb_image.h"
 
 #include "../template/Matrix.tpp"
 
-struct Vertex {
-    cookie::Vector3D<float> pos;
-    cookie::Vector3D<float> color;
-    cookie::Vector2D<float> texCoord;
-
-    static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
-    }
-
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
-
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-        return attributeDescriptions;
-    }
-
-    bool operator==(const Vertex& other) const {
-        return pos == other.pos && color == other.color && texCoord == other.texCoord;
-    }
-};
-
-inline void hashCombine(std::size_t& seed, std::size_t value) {
-    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-}
-
-namespace std {
-    template<>
-    struct hash<Vertex> {
-        size_t operator()(const Vertex& vertex) const noexcept {
-            size_t seed = 0;
-            // Manually hash each float component if cookie::Vector* lacks hashing
-            hashCombine(seed, std::hash<float>()(vertex.pos.x));
-            hashCombine(seed, std::hash<float>()(vertex.pos.y));
-            hashCombine(seed, std::hash<float>()(vertex.pos.z));
-
-            hashCombine(seed, std::hash<float>()(vertex.color.x));
-            hashCombine(seed, std::hash<float>()(vertex.color.y));
-            hashCombine(seed, std::hash<float>()(vertex.color.z));
-
-            hashCombine(seed, std::hash<float>()(vertex.texCoord.x));
-            hashCombine(seed, std::hash<float>()(vertex.texCoord.y));
-
-            return seed;
-        }
-    };
-}
-
 struct UniformBufferObject {
     cookie::Matrix4D<float> model;
     cookie::Matrix4D<float> view;
     cookie::Matrix4D<float> proj;
 };
 
+// Push constants of the vertex shader, laid out like its Transform block: proj * view * model, combined on the CPU
+struct TransformConstants {
+    cookie::Matrix4D<float> mvp;
+};
+
+static_assert(sizeof(TransformConstants) == 64);
+
+// Push constants of the fragment shader, laid out like its Shading block, right after TransformConstants
+struct ShadingConstants {
+    uint32_t useTexture;
+};
+
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // a family with transfer but without graphics support, usually backed by the copy engines
+    std::optional<uint32_t> transferFamily;
 
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
     }
 };
 
+// A texture whose level 0 was uploaded on the transfer queue, its other levels are blitted by the next frame
+struct PendingMipmaps {
+    VkImage image;
+    int32_t width;
+    int32_t height;
+    uint32_t mipLevels;
+};
+
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR capabilities;
     std::vector<VkSurfaceFormatKHR> formats;
@@ -116,64 +79,132 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// Layout of the header the driver writes in front of its pipeline cache data (VkPipelineCacheHeaderVersionOne)
+struct PipelineCacheHeader {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
 constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+constexpr VkDeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+constexpr const char* PIPELINE_CACHE_PATH = "shader/pipeline.cache";
+
+// Timestamp queries of a frame: around the acquire and mipmap work of its uploads, then around its render pass
+enum FrameQuery : uint32_t {
+    QUERY_UPLOADS_BEGIN,
+    QUERY_UPLOADS_END,
+    QUERY_RENDER_PASS_BEGIN,
+    QUERY_RENDER_PASS_END,
+    QUERY_COUNT
+};
 
 class VulkanApplication {
     private:
-        sf::Window                  &window;
+        // null when rendering offscreen (headless)
+        sf::Window                  *window;
         VkInstance                  instance = VK_NULL_HANDLE;
         VkDebugUtilsMessengerEXT    debugMessenger = VK_NULL_HANDLE;
         VkPhysicalDevice            physicalDevice = VK_NULL_HANDLE;
         VkPhysicalDeviceProperties  physicalDeviceProperties = {};
         VkDevice                    logicalDevice = VK_NULL_HANDLE;
+        std::optional<MemoryAllocator> allocator;
+        std::optional<StagingRing>  stagingRing;
+        VkCommandBuffer             uploadCommandBuffer = VK_NULL_HANDLE;
+        size_t                      uploadCommandCount = 0;
+        std::deque<std::pair<uint64_t, VkCommandBuffer>> uploadsInFlight;
+        // ownership of the resources uploaded on a dedicated transfer queue is acquired by the next frame, after
+        // waiting for the semaphores signaled by their uploads
+        std::vector<VkBufferMemoryBarrier> bufferAcquires;
+        std::vector<VkImageMemoryBarrier> imageAcquires;
+        std::vector<PendingMipmaps> pendingMipmaps;
+        std::vector<VkSemaphore>    uploadSemaphores;
+        std::vector<VkSemaphore>    freeUploadSemaphores;
+        std::vector<std::vector<VkSemaphore>> frameUploadSemaphores;
+        std::vector<VkCommandBuffer> frameAcquireCommandBuffers;
         VkQueue                     graphicsQueue = VK_NULL_HANDLE;
         VkQueue                     presentQueue = VK_NULL_HANDLE;
+        VkQueue                     transferQueue = VK_NULL_HANDLE;
+        uint32_t                    graphicsFamily = 0;
+        uint32_t                    transferFamily = 0;
         VkSurfaceKHR                surface = VK_NULL_HANDLE;
         VkSwapchainKHR              swapChain = VK_NULL_HANDLE;
         std::vector<VkImage>        swapChainImages;
+        std::vector<Allocation>     offscreenImagesMemory;
         VkFormat                    swapChainImageFormat = VK_FORMAT_UNDEFINED;
         VkExtent2D                  swapChainExtent = {};
         std::vector<VkImageView>    swapChainImageViews;
         VkRenderPass                renderPass = VK_NULL_HANDLE;
         VkPipelineLayout            pipelineLayout = VK_NULL_HANDLE;
         VkPipeline                  graphicsPipeline = VK_NULL_HANDLE;
+        VkPipelineCache             pipelineCache = VK_NULL_HANDLE;
+        bool                        pipelineCacheWarm = false;
         std::vector<VkFramebuffer>  swapChainFrameBuffers;
         VkCommandPool               commandPool = VK_NULL_HANDLE;
+        VkCommandPool               transferCommandPool = VK_NULL_HANDLE;
         std::vector<VkCommandBuffer>commandBuffer;
+        // one per swap chain image and frame in flight, indexed image * MAX_FRAMES_IN_FLIGHT + frame, replayed
+        // as long as they were recorded in the current command generation
+        std::vector<VkCommandBuffer>recordedCommandBuffers;
+        std::vector<uint64_t>       recordedGenerations;
+        uint64_t                    commandGeneration = 1;
+        bool                        recordedUseTexture = false;
         std::vector<VkSemaphore>    imageAvailableSemaphore;
         std::vector<VkSemaphore>    renderFinishedSemaphore;
         std::vector<VkFence>        inFlightFence;
+        // one timestamp pool per frame in flight, read back once its fence signaled so it never stalls
+        std::vector<VkQueryPool>    timestampQueryPools;
+        std::vector<bool>           frameTimestamped;
+        std::vector<bool>           frameUploadsTimestamped;
+        bool                        timestamps = false;
+        uint64_t                    timestampMask = 0;
+        FrameStats                  frameStats;
         VkBuffer                    vertexBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory              vertexBufferMemory = VK_NULL_HANDLE;
+        Allocation                  vertexBufferMemory;
         VkBuffer                    indexBuffer = VK_NULL_HANDLE;
-        VkDeviceMemory              indexBufferMemory = VK_NULL_HANDLE;
+        Allocation                  indexBufferMemory;
         VkDescriptorSetLayout       descriptorSetLayout = VK_NULL_HANDLE;
         std::vector<VkBuffer>       uniformBuffers;
-        std::vector<VkDeviceMemory> uniformBuffersMemory;
+        std::vector<Allocation>     uniformBuffersMemory;
         std::vector<void*>          uniformBuffersMapped;
         VkDescriptorPool            descriptorPool = VK_NULL_HANDLE;
         std::vector<VkDescriptorSet>descriptorSets;
+        uint32_t                    mipLevels = 1;
+        VkFormat                    textureImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
         VkImage                     textureImage = VK_NULL_HANDLE;
-        VkDeviceMemory              textureImageMemory = VK_NULL_HANDLE;
+        Allocation                  textureImageMemory;
         VkImageView                 textureImageView = VK_NULL_HANDLE;
         VkSampler                   textureSampler = VK_NULL_HANDLE;
         VkImage                     dummyTextureImage = VK_NULL_HANDLE;
-        VkDeviceMemory              dummyTextureImageMemory = VK_NULL_HANDLE;
+        Allocation                  dummyTextureImageMemory;
         VkImageView                 dummyTextureImageView = VK_NULL_HANDLE;
         VkSampler                   dummyTextureSampler = VK_NULL_HANDLE;
         VkImage                     depthImage = VK_NULL_HANDLE;
-        VkDeviceMemory              depthImageMemory = VK_NULL_HANDLE;
+        Allocation                  depthImageMemory;
         VkImageView                 depthImageView = VK_NULL_HANDLE;
-        std::vector<Vertex>         vertices;
-        std::vector<uint32_t>       indices;
+        std::span<const SubMesh>    subMeshes;
+        std::vector<PackedVertex>   packedVertices;
+        VertexBounds                vertexBounds = {};
 
         bool                        verbose;
+        bool                        packed;
+        bool                        textureCompressionBC = false;
+        // whether the pipeline cache is read from and written back to PIPELINE_CACHE_PATH
+        bool                        cache;
+        // whether frames replay recordedCommandBuffers instead of recording commandBuffer every frame
+        bool                        prerecorded;
+        // whether the transform is pushed with the draws, the uniform buffer is then left as it is
+        bool                        pushTransform;
+        TransformConstants          transform = {};
         int                         currentFrame = 0;
+        uint64_t                    frameCount = 0;
         bool                        frameBufferResized = false;
         bool                        swapChainState = false;
-        std::string                 texturePath;
-        const Obj&                  obj;
-        const float                 map_Kd[3] = {255.0, 255.0, 255.0};
+        // set by loadScene, the mesh is drawn from until the application is destroyed
+        const MeshCache*            mesh = nullptr;
+        SceneTexture*               texture = nullptr;
 
         void                        initVulkan();
         bool                        checkValidationLayerSupport();
@@ -202,6 +233,7 @@ class VulkanApplication {
 
         void                        createSwapChain();
         void                        recreateSwapChain();
+        void                        createOffscreenImages();
 
         void                        createImageViews();
 
@@ -209,6 +241,9 @@ class VulkanApplication {
 
         void                        createDescriptorSetLayout();
 
+        void                        createPipelineCache();
+        void                        savePipelineCache();
+
         void                        createGraphicsPipeline();
         VkShaderModule              createShaderModule(const std::vector<char>& code) const;
 
@@ -222,24 +257,27 @@ class VulkanApplication {
         bool                        hasStencilComponent(VkFormat format);
 
         void                        createTextureImage();
-        void                        createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-        VkCommandBuffer             beginSingleTimeCommands();
-        void                        endSingleTimeCommands(VkCommandBuffer commandBuffer);
-        void                        transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-        void                        copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+        bool                        createCompressedTextureImage();
+        void                        createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& imageMemory);
+        // transfers are recorded in one command buffer, submitted once by submitUploads
+        VkCommandBuffer             getUploadCommandBuffer();
+        void                        submitUploads();
+        void                        waitUploads();
+        bool                        hasTransferQueue() const;
+        VkCommandBuffer             recordAcquires();
+        void                        transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
+        void                        copyBufferToImage(VkBuffer buffer, VkDeviceSize offset, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevel);
+        void                        generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, int32_t width, int32_t height, uint32_t mipLevels);
 
         void                        createTextureImageView();
-        VkImageView                 createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+        VkImageView                 createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
 
         void                        createTextureSampler();
         void                        createDummyTexture();
 
-        void                        loadModel();
-
         void                        createVertexBuffer();
-        void                        createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-        uint32_t                    findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-        void                        copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+        void                        createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferMemory);
+        void                        copyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize size);
 
         void                        createIndexBuffer();
 
@@ -250,27 +288,40 @@ class VulkanApplication {
         void                        createDescriptorSets();
 
         void                        createCommandBuffer();
+        void                        createRecordedCommandBuffers();
         void                        recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
         void                        createSyncObjects();
 
+        void                        createQueryPools();
+        void                        readTimestamps();
+
         void                        cleanUp();
         void                        cleanupSwapChain();
 
         void                        updateUniformBuffer(uint32_t currentImage);
     public:
-        explicit                    VulkanApplication(bool verbose, sf::Window& window, std::string texturePath, const Obj& obj);
-        explicit                    VulkanApplication(bool verbose, sf::Window& window, const cookie::Vector3D<float>& Kd, const Obj& obj);
+        // Creates the device, swap chain and pipeline, which need nothing from the scene so they are created
+        // while its files are still being loaded
+        explicit                    VulkanApplication(bool verbose, sf::Window& window, bool packed, bool cache, bool prerecorded, bool pushTransform);
+        // Renders into offscreen images of `extent` instead of a window's swap chain
+        explicit                    VulkanApplication(bool verbose, VkExtent2D extent, bool packed, bool cache, bool prerecorded, bool pushTransform);
 
         ~VulkanApplication();
 
+        // Uploads the texture and the mesh, before the first frame. `mesh` has to outlive the application
+        void                        loadScene(const MeshCache& mesh, SceneTexture& texture);
         void                        drawFrame();
+        // Reads back the last frame drawn offscreen, RGBA8 and sRGB encoded, throws when there is none
+        void                        captureFrame(std::vector<uint8_t>& pixels);
+        [[nodiscard]] VkExtent2D    getExtent() const;
 		void						wait();
         void                        triggerResize();
 
         float                       zoom = 2.0f;
         bool                        useTexture = false;
-        bool                        updateTexture = false;
+        // copies of the mesh drawn on top of each other, to load the vertex stage. Set before the first frame
+        uint32_t                    instances = 1;
         float                       center_x = 0.0f;
         float                       center_y = 0.0f;
         float                       center_z = 0.0f;
@@ -1,4 +1,11 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <numeric>
 #include <string>
 
 #include <SFML/Window/Window.hpp>
@@ -8,7 +15,14 @@
 
 #include "include/Obj.hpp"
 #include "include/MaterialLoader.hpp"
+#include "include/MeshCache.hpp"
 #include "include/VulkanApplication.hpp"
+#include "include/Benchmark.hpp"
+#include "include/Png.hpp"
+#include "include/Profiler.hpp"
+#include "include/SceneTexture.hpp"
+#include "include/StartupTimeline.hpp"
+#include "include/ThreadPool.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "include/stb_image.h"
@@ -44,7 +58,6 @@ void handle_key_pressed(const sf::Event::KeyPressed* event, sf::Window& window,
 
         case sf::Keyboard::Key::Space:
             app.useTexture = !app.useTexture;
-            app.updateTexture = true;
             break;
     }
 }
@@ -56,72 +69,348 @@ void handle_key_released(const sf::Event::KeyReleased* event, sf::Window& window
     }
 }
 
+// Draws `frames` frames offscreen as fast as the device allows and reports their time percentiles. With frames
+// in flight, drawFrame waits for the frame that last used its slot, so once the pipeline is full these are GPU
+// frame times. `vertices` is the index count of the mesh, drawn once per instance, for the vertex throughput.
+// The last frame is written to `dump` when given, for golden image comparisons
+int run_headless(VulkanApplication& app, size_t frames, size_t vertices, const std::string& dump) {
+    std::vector<double> times;
+    times.reserve(frames);
+
+    try {
+        for (size_t frame = 0; frame < frames; frame++) {
+            const auto start = std::chrono::steady_clock::now();
+            app.drawFrame();
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        app.wait();
+    } catch (std::exception &error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    const double total = std::accumulate(times.begin(), times.end(), 0.0);
+    std::ranges::sort(times);
+
+    // nearest rank
+    const auto percentile = [&times](double rank) {
+        const size_t index = static_cast<size_t>(std::ceil(rank * static_cast<double>(times.size())));
+        return times[std::clamp<size_t>(index, 1, times.size()) - 1];
+    };
+
+    const VkExtent2D extent = app.getExtent();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Headless " << extent.width << "x" << extent.height << ": " << frames << " frames in " << total << " ms, "
+              << static_cast<double>(frames) * 1000.0 / total << " fps" << std::endl;
+    std::cout << "Frame time (ms): min " << times.front() << ", p50 " << percentile(0.5) << ", p90 " << percentile(0.9)
+              << ", p99 " << percentile(0.99) << ", max " << times.back() << std::endl;
+    std::cout << "Vertex throughput: " << static_cast<double>(vertices * app.instances) * static_cast<double>(frames) / total / 1000.0
+              << " M vertices/s (" << app.instances << " instances of " << vertices << ")" << std::endl;
+
+    if (dump.empty() == false) {
+        try {
+            std::vector<uint8_t> pixels;
+            app.captureFrame(pixels);
+            writePng(dump, pixels.data(), extent.width, extent.height);
+        } catch (std::exception &error) {
+            std::cerr << "Failed to dump the last frame: " << error.what() << std::endl;
+            return 1;
+        }
+
+        std::cout << "Last frame written to " << dump << std::endl;
+    }
+
+    return 0;
+}
+
 int main(const int argc, const char *argv[]) {
     if (argc == 1) {
         std::cerr << "Usage: " << argv[0] << " [filename] [option]" << std::endl;
         return 1;
     }
 
-    if (sf::Vulkan::isAvailable(true) == false) {
+    bool verbose = false;
+    bool benchmark = false;
+    bool cache = true;
+    bool optimize = true;
+    bool packed = false;
+    bool prerecorded = false;
+    bool pushTransform = false;
+    uint32_t instances = 1;
+    std::optional<TextureFormat> compression = TextureFormat::BC7;
+    std::optional<VkExtent2D> headless;
+    size_t frames = 500;
+    std::string dump;
+    std::string trace;
+
+    for (int index = 2; index < argc; index++) {
+        const std::string option(argv[index]);
+
+        if (option == "--verbose") {
+            verbose = true;
+        } else if (option == "--benchmark") {
+            benchmark = true;
+        } else if (option == "--no-cache") {
+            cache = false;
+        } else if (option == "--no-optimize") {
+            optimize = false;
+        } else if (option == "--packed-vertices") {
+            packed = true;
+        } else if (option == "--prerecord") {
+            prerecorded = true;
+        } else if (option == "--push-constants") {
+            pushTransform = true;
+        } else if (option == "--instances" && index + 1 < argc) {
+            instances = static_cast<uint32_t>(std::strtoul(argv[++index], nullptr, 10));
+
+            if (instances == 0) {
+                std::cerr << "Invalid instance count: " << argv[index] << std::endl;
+                return 1;
+            }
+        } else if (option == "--bc1") {
+            compression = TextureFormat::BC1;
+        } else if (option == "--no-compress") {
+            compression.reset();
+        } else if (option == "--headless" && index + 1 < argc) {
+            VkExtent2D extent{};
+            char end;
+
+            if (std::sscanf(argv[++index], "%ux%u%c", &extent.width, &extent.height, &end) != 2 || extent.width == 0 || extent.height == 0) {
+                std::cerr << "Invalid headless size: " << argv[index] << ", expected WIDTHxHEIGHT" << std::endl;
+                return 1;
+            }
+            headless = extent;
+        } else if (option == "--frames" && index + 1 < argc) {
+            frames = std::strtoul(argv[++index], nullptr, 10);
+
+            if (frames == 0) {
+                std::cerr << "Invalid frame count: " << argv[index] << std::endl;
+                return 1;
+            }
+        } else if (option == "--dump-frame" && index + 1 < argc) {
+            dump = argv[++index];
+        } else if (option == "--trace" && index + 1 < argc) {
+            trace = argv[++index];
+        } else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (benchmark) {
+        try {
+            benchmarkLoader(argv[1]);
+            benchmarkWeld(argv[1]);
+            benchmarkTriangulator();
+            benchmarkPacking(argv[1]);
+            benchmarkMipmaps();
+            benchmarkBlockCompression();
+        } catch (std::exception &error) {
+            std::cerr << error.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // the pushed transform changes every frame, the recorded command buffers would be recorded every frame too
+    if (prerecorded && pushTransform) {
+        std::cerr << "--push-constants cannot be used with --prerecord" << std::endl;
+        return 1;
+    }
+
+    if (dump.empty() == false && headless.has_value() == false) {
+        std::cerr << "--dump-frame needs --headless" << std::endl;
+        return 1;
+    }
+
+    // headless runs do not touch the display, the CI boxes running them have none
+    if (headless.has_value() == false && sf::Vulkan::isAvailable(true) == false) {
         std::cerr << "Vulkan is not available" << std::endl;
         return 2;
     }
 
-    if (!XInitThreads()) {
+    if (headless.has_value() == false && !XInitThreads()) {
         std::cerr << "Failed to initialize X11 threads!" << std::endl;
         return 3;
     }
 
-    const Obj object(argv[1]);
-    const bool verbose = argc == 3 && std::string(argv[2]) == "--verbose";
-
-    if (verbose) {
-        std::cout << "Data loaded : " << std::endl;
-        std::cout << object << std::endl;
+#ifndef SCOPE_PROFILER
+    if (trace.empty() == false) {
+        std::cerr << "--trace needs a build with SCOPE_PROFILER" << std::endl;
+        return 1;
     }
+#endif
+
+    if (trace.empty() == false)
+        Profiler::start();
+
+    // written on the way out of main, once the application and the startup pool are destroyed
+    struct TraceFile {
+        const std::string& path;
 
-    std::optional<MaterialLoader> material;
+        ~TraceFile() {
+            if (path.empty())
+                return;
 
-    if (object.hasImage()) {
-        material.emplace(object.getMaterialPath());
-        if (verbose) {
-            std::cout << "Material loaded : " << std::endl;
-            std::cout << material.value() << std::endl;
+            try {
+                Profiler::write(path);
+                std::cout << "Trace written to " << path << std::endl;
+            } catch (std::exception &error) {
+                std::cerr << "Failed to write the trace: " << error.what() << std::endl;
+            }
         }
-    }
+    } traceFile{trace};
+
+    StartupTimeline timeline;
+
+    std::optional<MeshCache> mesh;
+    SceneTexture texture;
+    std::future<void> textureTask;
+
+    // the model, its material and its texture are loaded on the startup pool while the window, the device and
+    // the pipeline are created, the texture as soon as the material names it
+    ThreadPool startup(2);
+
+    std::future<void> modelTask = startup.submit([&] {
+        std::optional<Obj> object;
+
+        if (cache) {
+            timeline.measure("mesh cache", [&] {
+                try {
+                    mesh.emplace(argv[1]);
+                } catch (std::exception &error) {
+                    if (verbose)
+                        std::cout << "Mesh cache not used: " << error.what() << std::endl;
+                }
+            });
+        }
+
+        if (mesh.has_value() == false) {
+            timeline.measure("model parse", [&] {
+                object.emplace(argv[1], ObjLoader::Parallel);
+            });
+
+            if (verbose) {
+                std::cout << "Data loaded : " << std::endl;
+                std::cout << object.value() << std::endl;
+            }
+        }
+
+        const std::vector<std::string>& material_path = mesh.has_value() ? mesh->getMaterialPath() : object->getMaterialPath();
+        std::optional<MaterialLoader> material;
+
+        if (material_path.empty() == false) {
+            timeline.measure("material", [&] {
+                material.emplace(material_path);
+            });
+
+            if (verbose) {
+                std::cout << "Material loaded : " << std::endl;
+                std::cout << material.value() << std::endl;
+            }
+        }
+
+        const bool textured = material.has_value() && material.value().getMaterials()[0].map_Kd.empty() == false;
+
+        if (textured) {
+            texture.path = material.value().getMaterials()[0].map_Kd;
+
+            textureTask = startup.submit([&] {
+                timeline.measure("texture", [&] {
+                    loadTexture(texture, compression, cache, verbose);
+                });
+            });
+        } else if (material.has_value()) {
+            for (size_t channel = 0; channel < 3; channel++)
+                texture.color[channel] = material.value().getMaterials()[0].Kd[channel] * 255.0f;
+        }
+
+        // the cache was built for a material with (or without) a texture map and with (or without) the vertex
+        // cache optimisation, rebuild it if either changed since
+        if (mesh.has_value() && (mesh->isTextured() != textured || mesh->isOptimized() != optimize)) {
+            if (verbose)
+                std::cout << "Mesh cache not used: built with other options" << std::endl;
+
+            mesh.reset();
+            timeline.measure("model parse", [&] {
+                object.emplace(argv[1], ObjLoader::Parallel);
+            });
+        }
+
+        if (mesh.has_value() == false) {
+            timeline.measure("mesh build", [&] {
+                mesh.emplace(object.value(), textured, optimize, verbose);
+            });
+            object.reset();
 
-    sf::VideoMode desktopMode = sf::VideoMode::getDesktopMode();
+            if (cache) {
+                try {
+                    mesh->save(argv[1]);
+                } catch (std::exception &error) {
+                    std::cerr << "Failed to write mesh cache: " << error.what() << std::endl;
+                }
+            }
+        }
+
+        if (verbose)
+            std::cout << mesh.value() << std::endl;
+    });
+
+    std::optional<sf::Window> window;
 
-    desktopMode.size.x /= 2;
-    desktopMode.size.y /= 2;
+    if (headless.has_value() == false) {
+        sf::VideoMode desktopMode = sf::VideoMode::getDesktopMode();
 
-    sf::Window window(desktopMode, "Scope", sf::Style::Close, sf::State::Windowed);
+        desktopMode.size.x /= 2;
+        desktopMode.size.y /= 2;
+
+        window.emplace(desktopMode, "Scope", sf::Style::Close, sf::State::Windowed);
+    }
 
 	std::optional<VulkanApplication> app;
 
 	try {
-	    if (object.hasImage() && material.value().getMaterials()[0].map_Kd.empty() == false)
-            app.emplace(verbose, window, material.value().getMaterials()[0].map_Kd, object);
-	    else if (object.hasImage())
-	        app.emplace(verbose, window, cookie::Vector3D(material.value().getMaterials()[0].Kd[0] * 255.0f, material.value().getMaterials()[0].Kd[1] * 255.0f, material.value().getMaterials()[0].Kd[2] * 255.0f), object);
-	    else
-	        app.emplace(verbose, window, "", object);
+	    timeline.measure("vulkan device", [&] {
+	        if (headless.has_value())
+	            app.emplace(verbose, headless.value(), packed, cache, prerecorded, pushTransform);
+	        else
+	            app.emplace(verbose, window.value(), packed, cache, prerecorded, pushTransform);
+	        app->instances = instances;
+	    });
+
+	    timeline.measure("wait for scene", [&] {
+	        modelTask.get();
+	        if (textureTask.valid())
+	            textureTask.get();
+	    });
+
+	    timeline.measure("upload", [&] {
+	        app->loadScene(mesh.value(), texture);
+	    });
 	} catch (std::exception &error) {
 	    std::cerr << "creating application failed" << std::endl;
 		std::cerr << error.what() << std::endl;
 		return (1);
 	}
 
+    if (verbose)
+        std::cout << timeline << std::endl;
+
+    if (headless.has_value())
+        return run_headless(app.value(), frames, mesh->getIndices().size(), dump);
+
     app->wait();
 
-    while (window.isOpen() && run) {
-        while (const std::optional event = window.pollEvent()) {
+    while (window->isOpen() && run) {
+        while (const std::optional event = window->pollEvent()) {
             if (event->is<sf::Event::Closed>())
-                window.close();
+                window->close();
             if (event->is<sf::Event::KeyPressed>())
-                handle_key_pressed(event->getIf<sf::Event::KeyPressed>(), window, app.value());
+                handle_key_pressed(event->getIf<sf::Event::KeyPressed>(), window.value(), app.value());
             if (event->is<sf::Event::KeyReleased>())
-                handle_key_released(event->getIf<sf::Event::KeyReleased>(), window, app.value());
+                handle_key_released(event->getIf<sf::Event::KeyReleased>(), window.value(), app.value());
             if (event->is<sf::Event::Resized>())
                 app->triggerResize();
         }
@@ -129,11 +418,11 @@ int main(const int argc, const char *argv[]) {
         try {
             app->drawFrame();
         } catch (std::exception &error) {
-            if (window.isOpen() == false)
+            if (window->isOpen() == false)
                 app->wait();
             else
                 std::cerr << error.what() << std::endl;
-            return window.isOpen();
+            return window->isOpen();
         }
     }
 
@@ -6,15 +6,26 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 proj;
 } ubo;
 
+// set when the pipeline is created: the combined transform is pushed every frame instead of read from the ubo
+layout(constant_id = 0) const bool PUSH_TRANSFORM = false;
+
+layout(push_constant) uniform Transform {
+    mat4 mvp;
+} transform;
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
-layout(location = 0) out vec3 fragColor;
+// the face color is only set on the provoking vertex of each triangle
+layout(location = 0) flat out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    if (PUSH_TRANSFORM)
+        gl_Position = transform.mvp * vec4(inPosition, 1.0);
+    else
+        gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
     fragColor = inColor;
     fragTexCoord = inTexCoord;
 }
\ No newline at end of file
@@ -147,6 +147,19 @@ namespace cookie {
         return result;
     }
 
+    template<typename Type>
+    Matrix4D<Type> scale(const Matrix4D<Type>& mat, const Vector3D<Type>& vec) {
+        Matrix4D<Type> result = mat;
+
+        for (int row = 0; row < 4; ++row) {
+            result[0][row] *= vec.x;
+            result[1][row] *= vec.y;
+            result[2][row] *= vec.z;
+        }
+
+        return result;
+    }
+
     template<typename Type>
     Matrix4D<Type> lookAt(const Vector3D<Type>& eye, const Vector3D<Type>& center, const Vector3D<Type>& up) {
         const cookie::Vector3D<float> f = cookie::normalize(cookie::subtract(center, eye));
@@ -17,7 +17,7 @@ namespace cookie
         Vector3D();
         Vector3D(Type x, Type y, Type z);
         Vector3D(Type value);
-        ~Vector3D();
+        ~Vector3D() = default;
 
         Type getX() const;
         Type getY() const;
@@ -44,7 +44,7 @@ namespace cookie
     public:
         Vector2D();
         Vector2D(Type x, Type y);
-        ~Vector2D();
+        ~Vector2D() = default;
 
         Type getX() const;
         Type getY() const;
@@ -73,9 +73,6 @@ namespace cookie
 
     }
 
-    template <class Type>
-    Vector3D<Type>::~Vector3D() = default;
-
     template <class Type>
     Type Vector3D<Type>::getX() const {
         return x;
@@ -139,9 +136,6 @@ namespace cookie
 
     }
 
-    template <class Type>
-    Vector2D<Type>::~Vector2D() = default;
-
 
     template <class Type>
     Type Vector2D<Type>::getX() const {
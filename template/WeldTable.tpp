@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cookie {
+    // Flat open-addressing table mapping a key to the index of its first occurrence, used to weld
+    // duplicated mesh corners. Keys are hashed and compared as raw bytes, so they must not have padding.
+    template <typename Key>
+    class WeldTable {
+        static_assert(std::is_trivially_copyable_v<Key> && std::has_unique_object_representations_v<Key>, "WeldTable keys are hashed as raw bytes");
+
+        private:
+            static constexpr uint32_t EMPTY = UINT32_MAX;
+
+            std::vector<Key> keys;
+            std::vector<uint32_t> values;
+            size_t mask = 0;
+            size_t count = 0;
+
+            static uint64_t hash(const Key& key);
+            void grow();
+
+        public:
+            // Sized so that `expected` keys stay under half load, no rehash happens while welding a mesh
+            explicit WeldTable(size_t expected = 0);
+            ~WeldTable();
+
+            // Returns the index stored for `key` and false, or stores `index` for it and returns it and true
+            std::pair<uint32_t, bool> insert(const Key& key, uint32_t index);
+
+            [[nodiscard]] size_t size() const;
+            [[nodiscard]] size_t capacity() const;
+    };
+
+    template <typename Key>
+    WeldTable<Key>::WeldTable(size_t expected) {
+        const size_t capacity = std::bit_ceil(std::max<size_t>(expected * 2, 16));
+
+        this->keys.resize(capacity);
+        this->values.assign(capacity, EMPTY);
+        this->mask = capacity - 1;
+    }
+
+    template <typename Key>
+    WeldTable<Key>::~WeldTable() = default;
+
+    template <typename Key>
+    uint64_t WeldTable<Key>::hash(const Key& key) {
+        unsigned char bytes[sizeof(Key)];
+        std::memcpy(bytes, &key, sizeof(Key));
+
+        uint64_t hash = 0x9e3779b97f4a7c15 ^ sizeof(Key);
+        size_t offset = 0;
+
+        for (; offset + sizeof(uint64_t) <= sizeof(Key); offset += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, bytes + offset, sizeof(word));
+            hash = (hash ^ word) * 0xbf58476d1ce4e5b9;
+            hash ^= hash >> 31;
+        }
+
+        if (offset < sizeof(Key)) {
+            uint64_t word = 0;
+            std::memcpy(&word, bytes + offset, sizeof(Key) - offset);
+            hash = (hash ^ word) * 0xbf58476d1ce4e5b9;
+            hash ^= hash >> 31;
+        }
+
+        // splitmix64 finalizer, the low bits pick the slot
+        hash ^= hash >> 30;
+        hash *= 0x94d049bb133111eb;
+        hash ^= hash >> 31;
+
+        return hash;
+    }
+
+    template <typename Key>
+    std::pair<uint32_t, bool> WeldTable<Key>::insert(const Key& key, uint32_t index) {
+        if ((this->count + 1) * 2 > this->values.size())
+            this->grow();
+
+        for (size_t slot = hash(key) & this->mask;; slot = (slot + 1) & this->mask) {
+            if (this->values[slot] == EMPTY) {
+                this->keys[slot] = key;
+                this->values[slot] = index;
+                this->count++;
+                return {index, true};
+            }
+
+            if (std::memcmp(&this->keys[slot], &key, sizeof(Key)) == 0)
+                return {this->values[slot], false};
+        }
+    }
+
+    template <typename Key>
+    void WeldTable<Key>::grow() {
+        std::vector<Key> keys(this->keys.size() * 2);
+        std::vector<uint32_t> values(this->values.size() * 2, EMPTY);
+        const size_t mask = values.size() - 1;
+
+        for (size_t old = 0; old < this->values.size(); old++) {
+            if (this->values[old] == EMPTY)
+                continue;
+
+            size_t slot = hash(this->keys[old]) & mask;
+            while (values[slot] != EMPTY)
+                slot = (slot + 1) & mask;
+
+            keys[slot] = this->keys[old];
+            values[slot] = this->values[old];
+        }
+
+        this->keys = std::move(keys);
+        this->values = std::move(values);
+        this->mask = mask;
+    }
+
+    template <typename Key>
+    size_t WeldTable<Key>::size() const {
+        return this->count;
+    }
+
+    template <typename Key>
+    size_t WeldTable<Key>::capacity() const {
+        return this->values.size();
+    }
+}